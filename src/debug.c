@@ -8,6 +8,7 @@
 #include "engine/piece.h"
 #include "engine/move.h"
 #include "engine/validator.h"
+#include "engine/zobrist.h"
 #include "engine/engine.h"
 #include "debug.h"
 
@@ -20,7 +21,7 @@ void pause() {
 Board *debug_generate_random() {
 	Board *b = calloc(1,sizeof(Board));
 	int i,j;
-	Piece *piece;
+	const Piece *piece;
 	// Init randomizer:
 	srand(time(NULL));
 
@@ -34,7 +35,7 @@ Board *debug_generate_random() {
 	b->black_can_en_passant = -1;	
 	for(i = 0; i < 8; i++) {
 		for (j = 0; j < 8; j++) {
-			b->fields[i][j] = NULL;
+			Board_set(b, i, j, NULL);
 		}
 	}
 
@@ -45,21 +46,22 @@ Board *debug_generate_random() {
 		y = rand() % 8;
 		shape = rand() % 6;
 		color = (rand() % 10 > 5 ? WHITE : BLACK);
-		piece = Piece_create(shape, color);
+		piece = Piece_get(shape, color);
 		Board_set(b, x, y, piece);
 		//printf("Put %s at ", piece->symbol);
 		//debug_print_square(x, y);
 	}
 	x = rand() % 8;
 	y = rand() % 8;
-	Board_set(b, x, y, Piece_create(KING, WHITE));
+	Board_set(b, x, y, Piece_get(KING, WHITE));
 	//printf("Put white King at ");
 	//debug_print_square(x, y);
 	while (Board_is_at(b, x, y, KING, WHITE)) {
 		x = rand() % 8;
 		y = rand() % 8;
 	}
-	Board_set(b, x, y, Piece_create(KING, BLACK));
+	Board_set(b, x, y, Piece_get(KING, BLACK));
+	b->hash = Zobrist_hash(b);
 	//printf("Put black King at ");
 	//debug_print_square(x, y);
 	return b;
@@ -89,10 +91,10 @@ void debug_print_mark(Board *b, int player, int x, int y) {
 			}
 			if (col == x && row == y) {
 				printf("XX");
-			} else if (b->fields[col][row] == NULL) {
+			} else if (Board_is_empty(b, col, row)) {
 				printf("  ");
 			} else {
-				char *name = Piece_short_name(b->fields[col][row]);
+				char *name = Piece_short_name(Board_get_piece(b, col, row));
 				printf("%s", name);
 			}			
 		}
@@ -130,14 +132,14 @@ void debug_print_check(Board *b, int player) {
 			} else {
 				row = 7-i; col = 7-j;
 			}
-			if (b->fields[col][row] == NULL) {
+			if (Board_is_empty(b, col, row)) {
 				if (v_square_gives_check(b, col, row, player)) {
 					printf("XX");
 				} else {
 					printf("  ");
 				}
 			} else {
-				char *name = Piece_short_name(b->fields[col][row]);
+				char *name = Piece_short_name(Board_get_piece(b, col, row));
 				printf("%s", name);
 			}			
 		}
@@ -12,39 +12,25 @@
 
 Move *AN_parse(char *str, Board *board) {
 	// Generate all moves:
-	Move *head = Move_alloc();
-	int color = Board_turn(board);
-	int total = v_get_all_valid_moves_for_color(&head, board, color);
-	if (total == 0) {
-		Move_destroy(head);
-		return NULL;
-	}
-
-	int any = false;
-	Move *curr = head;
-	while (curr) {
-		char *move = AN_format(board, curr, false, false);
-		if (strcmp(str, move) == 0) {
-			any = true;
-			free(move);
-			break;
+	MoveList moves;
+	int total = v_get_moves(&moves, board, Board_turn(board));
+	int i;
+	for (i = 0; i < total; i++) {
+		Move move;
+		Move_decode(moves.moves[i], &move);
+		char *str_move = AN_format(board, &move, false, false);
+		int found = (strcmp(str, str_move) == 0);
+		free(str_move);
+		if (found) {
+			return Move_clone(&move);
 		}
-		free(move);
-		curr = curr->next_sibling;
 	}
-	// Make a copy, so the rest can easily be destroyed in 1 go:
-	if (any) {
-		Move *result = Move_clone(curr);
-		Move_destroy(head);
-		return result;
-	}
-
 	return NULL;
 }
 
 char * AN_format(Board *board, Move *m, int complete, int show_number) {
-	Piece *p1 = Board_get_piece(board, m->x, m->y);
-	Piece *p2 = Board_get_piece(board, m->xx, m->yy);
+	const Piece *p1 = Board_get_piece(board, m->x, m->y);
+	const Piece *p2 = Board_get_piece(board, m->xx, m->yy);
 
 	// Move number
 	int number = (board->ply_count / 2 + 1);
@@ -199,4 +185,25 @@ char * AN_format(Board *board, Move *m, int complete, int show_number) {
 	return out;
 }
 
-
+char * AN_format_line(Board *board, uint32_t *moves, int count) {
+	// Room for the longest notation of each move, e.g. "100. ... Qa1xb2+"
+	char *out = malloc((count * 20 + 1) * sizeof(char));
+	UndoableMove *undo = malloc(count * sizeof(UndoableMove));
+	int len = 0;
+	int i;
+	out[0] = '\0';
+	for (i = 0; i < count; i++) {
+		Move move;
+		Move_decode(moves[i], &move);
+		// The first move gets a number either way, later ones only for white
+		char *str = AN_format(board, &move, i == 0, i == 0 || Board_turn(board) == WHITE);
+		len += sprintf(out + len, i == 0 ? "%s" : " %s", str);
+		free(str);
+		Board_make_move(board, &move, &undo[i]);
+	}
+	for (i = count - 1; i >= 0; i--) {
+		Board_undo_move(board, &undo[i]);
+	}
+	free(undo);
+	return out;
+}
@@ -1,3 +1,4 @@
+#include <stdint.h>
 #include "common.h"
 #include "datatypes.h"
 #include "move.h"
@@ -31,4 +32,13 @@ Move * AN_parse(char *str, Board *board);
  */
 char * AN_format(Board *board, Move *m, int complete, int show_number);
 
+/**
+ * Returns the shorthand notation of a line of moves, played one after
+ * the other from the given board configuration, with move numbers, e.g.:
+ * 4. ... Nc5 5. Qe2 Nxe4
+ * The moves are in their compact form (see MOVE_CODE in move.h).
+ * The board is changed while formatting, but restored afterwards.
+ */
+char * AN_format_line(Board *board, uint32_t *moves, int count);
+
 #endif
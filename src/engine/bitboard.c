@@ -0,0 +1,99 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "common.h"
+#include "datatypes.h"
+#include "bitboard.h"
+#include "magic.h"
+
+Bitboard PAWN_ATTACKS[2][64];
+Bitboard KNIGHT_ATTACKS[64];
+Bitboard KING_ATTACKS[64];
+Bitboard BETWEEN[64][64];
+Bitboard LINE[64][64];
+
+/**
+ * Returns the bit for field (x, y), or 0 if it lies outside the board.
+ */
+static Bitboard bit_safe(int x, int y);
+
+extern inline int Bitboard_count(Bitboard b);
+
+extern inline int Bitboard_first(Bitboard b);
+
+extern inline int Bitboard_last(Bitboard b);
+
+extern inline int Bitboard_pop(Bitboard *b);
+
+extern inline bool Bitboard_has(Bitboard b, int x, int y);
+
+extern inline Bitboard Bitboard_pawn_attacks(int color, int sq);
+
+extern inline Bitboard Bitboard_knight_attacks(int sq);
+
+extern inline Bitboard Bitboard_king_attacks(int sq);
+
+extern inline Bitboard Bitboard_rook_attacks(int sq, Bitboard occupancy);
+
+extern inline Bitboard Bitboard_bishop_attacks(int sq, Bitboard occupancy);
+
+extern inline Bitboard Bitboard_queen_attacks(int sq, Bitboard occupancy);
+
+extern inline Bitboard Bitboard_between(int a, int b);
+
+extern inline Bitboard Bitboard_line(int a, int b);
+
+static Bitboard bit_safe(int x, int y) {
+	if (x < 0 || x > 7 || y < 0 || y > 7) {
+		return 0;
+	}
+	return SQUARE_BIT(x, y);
+}
+
+void Bitboard_init() {
+	int sq;
+	for (sq = 0; sq < 64; sq++) {
+		int x = SQUARE_X(sq);
+		int y = SQUARE_Y(sq);
+		// White pawns move towards rank 8, i.e. towards y == 0
+		PAWN_ATTACKS[COLOR_INDEX(WHITE)][sq] = bit_safe(x - 1, y - 1) | bit_safe(x + 1, y - 1);
+		PAWN_ATTACKS[COLOR_INDEX(BLACK)][sq] = bit_safe(x - 1, y + 1) | bit_safe(x + 1, y + 1);
+		KNIGHT_ATTACKS[sq] = bit_safe(x - 1, y - 2) | bit_safe(x + 1, y - 2)
+				| bit_safe(x - 1, y + 2) | bit_safe(x + 1, y + 2)
+				| bit_safe(x - 2, y - 1) | bit_safe(x + 2, y - 1)
+				| bit_safe(x - 2, y + 1) | bit_safe(x + 2, y + 1);
+		KING_ATTACKS[sq] = bit_safe(x - 1, y - 1) | bit_safe(x, y - 1) | bit_safe(x + 1, y - 1)
+				| bit_safe(x - 1, y) | bit_safe(x + 1, y)
+				| bit_safe(x - 1, y + 1) | bit_safe(x, y + 1) | bit_safe(x + 1, y + 1);
+	}
+	Magic_init();
+
+	// The lines need the slider attacks, so fill them last
+	int a, b;
+	for (a = 0; a < 64; a++) {
+		for (b = 0; b < 64; b++) {
+			Bitboard bits = (1ULL << a) | (1ULL << b);
+			if (a == b) {
+				continue;
+			} else if (Bitboard_rook_attacks(a, 0) & (1ULL << b)) {
+				LINE[a][b] = (Bitboard_rook_attacks(a, 0) & Bitboard_rook_attacks(b, 0)) | bits;
+				BETWEEN[a][b] = Bitboard_rook_attacks(a, 1ULL << b) & Bitboard_rook_attacks(b, 1ULL << a);
+			} else if (Bitboard_bishop_attacks(a, 0) & (1ULL << b)) {
+				LINE[a][b] = (Bitboard_bishop_attacks(a, 0) & Bitboard_bishop_attacks(b, 0)) | bits;
+				BETWEEN[a][b] = Bitboard_bishop_attacks(a, 1ULL << b) & Bitboard_bishop_attacks(b, 1ULL << a);
+			}
+		}
+	}
+}
+
+void Bitboard_print(Bitboard b) {
+	int x, y;
+	for (y = 0; y < 8; y++) {
+		printf("%c ", '8' - y);
+		for (x = 0; x < 8; x++) {
+			printf(Bitboard_has(b, x, y) ? " x" : " .");
+		}
+		printf("\n");
+	}
+	printf("   a b c d e f g h\n");
+}
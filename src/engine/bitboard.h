@@ -0,0 +1,162 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "datatypes.h"
+#include "magic.h"
+
+/**
+ * bitboard.h / bitboard.c
+ *
+ * Helpers for working with bitboards: 64-bit sets of squares,
+ * where bit `y * 8 + x` stands for field (x, y) of the board.
+ * So bit 0 is a8, bit 7 is h8 and bit 63 is h1.
+ *
+ * Also contains the precomputed attack tables that the move
+ * generator and the evaluation use to find attacked squares without
+ * walking over the board. The sliding pieces use the magic tables
+ * from magic.h. Call Bitboard_init once at startup before using any
+ * of the attack functions.
+ *
+ */
+#ifndef _BITBOARD_H_
+#define _BITBOARD_H_
+
+/// Index of field (x, y) in a bitboard
+#define SQUARE(x, y) ((y) * 8 + (x))
+/// File (x) of a square index
+#define SQUARE_X(sq) ((sq) & 7)
+/// Rank (y) of a square index
+#define SQUARE_Y(sq) ((sq) >> 3)
+/// Bitboard with only field (x, y) set
+#define SQUARE_BIT(x, y) (1ULL << SQUARE(x, y))
+
+/// Index into Board.pieces and Board.occupied for the given color
+#define COLOR_INDEX(color) ((color) == WHITE ? 1 : 0)
+
+#define FILE_A_BITS (0x0101010101010101ULL)
+#define FILE_H_BITS (FILE_A_BITS << 7)
+
+/**
+ * Builds the attack tables, including the magic tables
+ * of the sliding pieces. Must be called once before
+ * any of the other functions in this file are used.
+ */
+void Bitboard_init();
+
+/**
+ * Returns the number of squares in the bitboard.
+ */
+inline int Bitboard_count(Bitboard b) {
+	return __builtin_popcountll(b);
+}
+
+/**
+ * Returns the index of the lowest square in the bitboard.
+ * The bitboard must not be empty.
+ */
+inline int Bitboard_first(Bitboard b) {
+	return __builtin_ctzll(b);
+}
+
+/**
+ * Returns the index of the highest square in the bitboard.
+ * The bitboard must not be empty.
+ */
+inline int Bitboard_last(Bitboard b) {
+	return 63 - __builtin_clzll(b);
+}
+
+/**
+ * Returns the index of the lowest square in the bitboard, and
+ * removes that square from the bitboard.
+ * The bitboard must not be empty.
+ */
+inline int Bitboard_pop(Bitboard *b) {
+	int sq = __builtin_ctzll(*b);
+	*b &= *b - 1;
+	return sq;
+}
+
+/**
+ * Returns true if field (x, y) is in the bitboard.
+ */
+inline bool Bitboard_has(Bitboard b, int x, int y) {
+	return (b & SQUARE_BIT(x, y)) != 0;
+}
+
+/// Attack tables, filled by Bitboard_init. Use the functions below instead.
+extern Bitboard PAWN_ATTACKS[2][64];
+extern Bitboard KNIGHT_ATTACKS[64];
+extern Bitboard KING_ATTACKS[64];
+
+/**
+ * Squares attacked by a pawn of the given color on square `sq`.
+ */
+inline Bitboard Bitboard_pawn_attacks(int color, int sq) {
+	return PAWN_ATTACKS[COLOR_INDEX(color)][sq];
+}
+
+/**
+ * Squares attacked by a knight on square `sq`.
+ */
+inline Bitboard Bitboard_knight_attacks(int sq) {
+	return KNIGHT_ATTACKS[sq];
+}
+
+/**
+ * Squares attacked by a king on square `sq`.
+ */
+inline Bitboard Bitboard_king_attacks(int sq) {
+	return KING_ATTACKS[sq];
+}
+
+/**
+ * Squares attacked by a rook on square `sq`, given the occupied squares.
+ * The first occupied square in each direction is included.
+ */
+inline Bitboard Bitboard_rook_attacks(int sq, Bitboard occupancy) {
+	Magic *m = &ROOK_MAGICS[sq];
+	return m->attacks[Magic_index(m, occupancy)];
+}
+
+/**
+ * Squares attacked by a bishop on square `sq`, given the occupied squares.
+ * The first occupied square in each direction is included.
+ */
+inline Bitboard Bitboard_bishop_attacks(int sq, Bitboard occupancy) {
+	Magic *m = &BISHOP_MAGICS[sq];
+	return m->attacks[Magic_index(m, occupancy)];
+}
+
+/**
+ * Squares attacked by a queen on square `sq`, given the occupied squares.
+ */
+inline Bitboard Bitboard_queen_attacks(int sq, Bitboard occupancy) {
+	return Bitboard_rook_attacks(sq, occupancy) | Bitboard_bishop_attacks(sq, occupancy);
+}
+
+/// Line tables, filled by Bitboard_init. Use the functions below instead.
+extern Bitboard BETWEEN[64][64];
+extern Bitboard LINE[64][64];
+
+/**
+ * Squares strictly between squares `a` and `b`, if they share
+ * a rank, file or diagonal. Otherwise returns 0.
+ */
+inline Bitboard Bitboard_between(int a, int b) {
+	return BETWEEN[a][b];
+}
+
+/**
+ * The full rank, file or diagonal through squares `a` and `b`,
+ * edge to edge. Returns 0 if they are not on one line.
+ */
+inline Bitboard Bitboard_line(int a, int b) {
+	return LINE[a][b];
+}
+
+/**
+ * Prints a bitboard as an 8x8 grid of dots and crosses.
+ */
+void Bitboard_print(Bitboard b);
+
+#endif
@@ -24,28 +24,9 @@ Board *Board_create() {
 
 Board *Board_clone(Board *src) {
 	Board *b = malloc(sizeof(Board));
-	int i,j;
-	for(i = 0; i < 8; i++) {
-		for (j = 0; j < 8; j++) {
-			if (src->fields[i][j] == NULL) {
-				b->fields[i][j] = NULL;
-			} else {
-				b->fields[i][j] = Piece_clone(src->fields[i][j]);
-			}
-		}
-	}
-	b->ply_count = src->ply_count;
-	b->fifty_move_count = src->fifty_move_count;
-
-	b->white_can_castle_kings_side = src->white_can_castle_kings_side;
-	b->white_can_castle_queens_side = src->white_can_castle_queens_side;
-	b->black_can_castle_kings_side = src->black_can_castle_kings_side;
-	b->black_can_castle_queens_side = src->black_can_castle_queens_side;
-	b->white_can_en_passant = src->white_can_en_passant;
-	b->black_can_en_passant = src->black_can_en_passant;
-	
-	b->state = src->state;
-
+	// Pieces are shared, so a plain copy will do.
+	// Only the list of captured pieces is left out.
+	*b = *src;
 	b->captures_white_count = 0;
 	b->captures_black_count = 0;
 	b->captures_white = NULL;
@@ -54,14 +35,6 @@ Board *Board_clone(Board *src) {
 }
 
 void Board_destroy(Board *b) {
-	int i,j;
-	for (i = 0; i < 8; i++) {
-		for(j = 0; j < 8; j++) {
-			if (b->fields[i][j] != NULL) {
-				Piece_destroy(b->fields[i][j]);
-			}
-		}
-	}
 	if (b->captures_white) {
 		Capture_destroy(b->captures_white);
 	}
@@ -108,15 +81,15 @@ void Board_reset(Board *b) {
 				shape = KING;
 			}
 			if (j <= 1) {
-				b->fields[i][j] = Piece_create(shape, BLACK);
+				Board_set(b, i, j, Piece_get(shape, BLACK));
 			} else if (j >= 6) {
-				b->fields[i][j] = Piece_create(shape, WHITE);
-			} else if (b->fields[i][j] != NULL) {
-				//Piece_destroy(b->fields[i][j]);
-				b->fields[i][j] = NULL;
+				Board_set(b, i, j, Piece_get(shape, WHITE));
+			} else {
+				Board_set(b, i, j, NULL);
 			}
 		}
 	}
+	b->hash = Zobrist_hash(b);
 }
 
 #ifdef UNICODE_OUTPUT
@@ -145,7 +118,7 @@ void Board_print(Board *b, int player) {
 			} else {
 				row = 7-i; col = 7-j;
 			}
-			Piece_print_color(b->fields[col][row]);
+			Piece_print_color(Board_get_piece(b, col, row));
 		}
 		if (player == BLACK) {
 			printf(" ║ %c  ", '1' + i);
@@ -215,7 +188,7 @@ void Board_print_color(Board *b, int player) {
 			} else {
 				row = 7-i; col = 7-j;
 			}
-			Piece_print_color(b->fields[col][row]);
+			Piece_print_color(Board_get_piece(b, col, row));
 		}
 		if (player == BLACK) {
 			printf("  %s  %c  ", resetcolor, '1' + i);
@@ -300,7 +273,7 @@ void Board_print(Board *b, int player) {
 			} else {
 				row = 7 - i; col = 7 - j;
 			}
-			Piece_print(b->fields[col][row]);
+			Piece_print(Board_get_piece(b, col, row));
 		}
 		if (player == BLACK) {
 			printf("| %c\n", '1' + i);
@@ -326,9 +299,9 @@ void Board_print(Board *b, int player) {
 }
 #endif
 
-extern inline Piece *Board_get_piece(Board *b, int x, int y);
+extern inline const Piece *Board_get_piece(Board *b, int x, int y);
 
-extern inline Piece *Board_get_piece_safe(Board *b, int x, int y);
+extern inline const Piece *Board_get_piece_safe(Board *b, int x, int y);
 
 extern inline bool Board_is_empty(Board *b, int x, int y);
 
@@ -340,13 +313,12 @@ extern inline bool Board_is_color(Board *b, int x, int y, int color);
 
 extern inline bool Board_is_type(Board *b, int x, int y, int shape);
 
-extern inline void Board_set(Board *b, int x, int y, Piece *p);
+extern inline void Board_set(Board *b, int x, int y, const Piece *p);
+
+extern inline int Board_king_square(Board *b, int color);
 
 void Board_remove_piece(Board *b, int x, int y) {
-	if (b->fields[x][y] == NULL)
-		return;
-	Piece_destroy(b->fields[x][y]);
-	b->fields[x][y] = NULL;
+	Board_set(b, x, y, NULL);
 }
 
 extern inline int Board_evaluate(Board *b);
@@ -364,13 +336,13 @@ bool Board_equals(bool quick, Board *left, Board *right) {
 	if (!ok) {
 		return false;
 	}
+	// Same pieces on the same squares means the same bitboards:
 	int i, j;
-	for (i = 0; i < 8; i++) {
-		for (j = 0;  j < 8; j++) {
-			if (left->fields[i][j] == NULL && Board_get_piece(right,i,j) == NULL)
-				continue;
-			if (left->fields[i][j] == NULL || !Piece_equals(left->fields[i][j], Board_get_piece(right, i, j)))
+	for (i = 0; i < 2; i++) {
+		for (j = PAWN; j <= KING; j++) {
+			if (left->pieces[i][j] != right->pieces[i][j]) {
 				return false;
+			}
 		}
 	}
 	return true;
@@ -378,13 +350,18 @@ bool Board_equals(bool quick, Board *left, Board *right) {
 
 
 UndoableMove *Board_do_move(Board *board, Move *move) {
-	assert(board != NULL && move != NULL);
+	UndoableMove *umove = malloc(sizeof(UndoableMove));
+	Board_make_move(board, move, umove);
+	return umove;
+}
+
+
+void Board_make_move(Board *board, Move *move, UndoableMove *umove) {
+	assert(board != NULL && move != NULL && umove != NULL);
 
 	int x = move->x, y = move->y;
 	int xx = move->xx, yy = move->yy;
-	Piece *piece, *target;
-	UndoableMove *umove;
-
+	const Piece *piece, *target;
 
 	piece = Board_get_piece(board, x, y);
 	target = Board_get_piece(board, xx, yy);
@@ -394,7 +371,7 @@ UndoableMove *Board_do_move(Board *board, Move *move) {
 	}
 	assert(piece != NULL);
 	
-	umove = Undo_create(
+	Undo_init(umove,
 				x, y, xx, yy
 				, yy
 				, target
@@ -404,12 +381,19 @@ UndoableMove *Board_do_move(Board *board, Move *move) {
 				, board->black_can_castle_kings_side 
 				, board->white_can_en_passant 
 				, board->black_can_en_passant);
+	// Take out the castling and en passant keys, they are put back in
+	// when the move is done. The pieces are taken care of by Board_set.
+	umove->hash = board->hash;
+	board->hash ^= Zobrist_state(board);
 	board->black_can_en_passant = -1;
 	board->white_can_en_passant = -1;
 	if (move->gives_check_mate) {
 		board->state = (Board_turn(board) == WHITE ? WHITE_WINS : BLACK_WINS);
 	}
 
+	// Lift the piece from its square
+	Board_set(board, x, y, NULL);
+
 	if (target == NULL && piece->shape != PAWN) {
 		board->fifty_move_count++;
 		umove->adds_to_fifty = true;
@@ -427,33 +411,16 @@ UndoableMove *Board_do_move(Board *board, Move *move) {
 		if (x == 4) {
 			if (xx == 6) {
 				// Move rook
-				board->fields[5][y] = board->fields[7][y];
-				board->fields[7][y] = NULL;
+				Board_set(board, 5, y, Board_get_piece(board, 7, y));
+				Board_set(board, 7, y, NULL);
 				umove->is_castling = true;
 			} else if (xx == 2) {
 				// Move rook
-				board->fields[3][y] = board->fields[0][y];
-				board->fields[0][y] = NULL;
+				Board_set(board, 3, y, Board_get_piece(board, 0, y));
+				Board_set(board, 0, y, NULL);
 				umove->is_castling = true;
 			}
 		}
-	// Disable castling if rooks move:
-	} else if (piece->shape == ROOK) {
-		if (piece->color == WHITE) {
-			if (board->fields[0][7] == NULL) {
-				board->black_can_castle_queens_side = false;
-			}
-			if (board->fields[7][7] == NULL) {
-				board->black_can_castle_kings_side = false;
-			}
-		} else {
-			if (board->fields[0][0] == NULL) {
-				board->black_can_castle_queens_side = false;
-			}
-			if (board->fields[7][0] == NULL) {
-				board->black_can_castle_kings_side = false;
-			}
-		}
 	// En-passant / pawn promotion
 	} else if (piece->shape == PAWN) {
 		// Check if this move enables the opponent to do en passant
@@ -461,8 +428,8 @@ UndoableMove *Board_do_move(Board *board, Move *move) {
 			// if pawn moves 2 steps forward, and directly to the left or
 			// right of it there is an opposing pawn, that enemy pawn may perform
 			// 'en passant' on the moving pawn.
-			if ((x > 0 && board->fields[x-1][yy] != NULL && board->fields[x-1][yy]->color == -piece->color)
-					|| (x < 7 && board->fields[x+1][yy] != NULL && board->fields[x+1][yy]->color == -piece->color)) {
+			if (Board_is_at_safe(board, x - 1, yy, PAWN, -piece->color)
+					|| Board_is_at_safe(board, x + 1, yy, PAWN, -piece->color)) {
 				if (piece->color == WHITE) {
 					board->black_can_en_passant = x;
 				} else {
@@ -471,27 +438,42 @@ UndoableMove *Board_do_move(Board *board, Move *move) {
 			}
 		}
 		// Check if this move is an en-passant move
-		if (abs(x - xx) == 1 && abs(y - yy) == 2 && board->fields[xx][yy] == NULL && board->fields[xx][y]->shape == PAWN) {
+		if (x != xx && target == NULL) {
 			// if pawn moves diagonally while target tile is empty,
 			// this move was an 'en passant' move. Remove the victim's body.
 			umove->hit_y = y;
-			umove->hit_piece = board->fields[xx][y];
-			board->fields[xx][y] = NULL;
+			umove->hit_piece = Board_get_piece(board, xx, y);
+			Board_set(board, xx, y, NULL);
 		}
 		// Check if this move queenifies a pawn
 		if ((piece->color == BLACK && yy == 7) || (piece->color == WHITE && yy == 0)) {
-			int color = piece->color;
-			Piece_destroy(piece);
-			piece = Piece_create(move->promotion, color);
+			piece = Piece_get(move->promotion, piece->color);
 			umove->is_promotion = true;
 		}
 	}
+	// Castling is no more possible with a rook that has
+	// moved away from, or was captured on, its starting square.
+	if ((x == 0 && y == 7) || (xx == 0 && yy == 7)) {
+		board->white_can_castle_queens_side = false;
+	}
+	if ((x == 7 && y == 7) || (xx == 7 && yy == 7)) {
+		board->white_can_castle_kings_side = false;
+	}
+	if ((x == 0 && y == 0) || (xx == 0 && yy == 0)) {
+		board->black_can_castle_queens_side = false;
+	}
+	if ((x == 7 && y == 0) || (xx == 7 && yy == 0)) {
+		board->black_can_castle_kings_side = false;
+	}
 
 	// Move the piece:
-	board->fields[xx][yy] = piece;
-	board->fields[x][y] = NULL;
+	Board_set(board, xx, yy, piece);
 	board->ply_count++;
-	return umove;
+	board->hash ^= Zobrist_state(board) ^ ZOBRIST_BLACK_TO_MOVE;
+	#ifdef DEBUG
+	assert(board->hash == Zobrist_hash(board));
+	assert(board->material == Fitness_material(board));
+	#endif
 }
 
 
@@ -499,28 +481,30 @@ void Board_undo_move(Board *board, UndoableMove *umove) {
 	assert(umove != NULL);
 
 	// Reposition the moved piece
+	const Piece *piece = Board_get_piece(board, umove->xx, umove->yy);
+	Board_set(board, umove->xx, umove->yy, NULL);
 	if (umove->is_promotion) {
-		board->fields[umove->x][umove->y] =
-			Piece_create(PAWN, board->fields[umove->xx][umove->yy]->color);
-	} else {
-		board->fields[umove->x][umove->y] = board->fields[umove->xx][umove->yy];
+		piece = Piece_get(PAWN, piece->color);
 	}
+	Board_set(board, umove->x, umove->y, piece);
 
 	if (umove->adds_to_fifty) {
 		board->fifty_move_count--;
 	}
 
 	// Restore any hit piece
-	board->fields[umove->xx][umove->hit_y] = umove->hit_piece;
+	if (umove->hit_piece != NULL) {
+		Board_set(board, umove->xx, umove->hit_y, umove->hit_piece);
+	}
 	
 	// Check for castling
 	if (umove->is_castling) {
 		if (umove->xx == 2) {
-			board->fields[0][umove->y] = board->fields[3][umove->y];
-			board->fields[3][umove->y] = NULL;
+			Board_set(board, 0, umove->y, Board_get_piece(board, 3, umove->y));
+			Board_set(board, 3, umove->y, NULL);
 		} else {
-			board->fields[7][umove->y] = board->fields[5][umove->y];
-			board->fields[5][umove->y] = NULL;
+			Board_set(board, 7, umove->y, Board_get_piece(board, 5, umove->y));
+			Board_set(board, 5, umove->y, NULL);
 		}
 	}
 	
@@ -531,9 +515,41 @@ void Board_undo_move(Board *board, UndoableMove *umove) {
 	board->white_can_en_passant = umove->white_can_en_passant;
 	board->black_can_en_passant = umove->black_can_en_passant;
 	board->ply_count--;
+	board->hash = umove->hash;
+	#ifdef DEBUG
+	assert(board->hash == Zobrist_hash(board));
+	assert(board->material == Fitness_material(board));
+	#endif
+}
+
+
+void Board_make_null_move(Board *board, UndoableMove *umove) {
+	umove->hash = board->hash;
+	umove->white_can_en_passant = board->white_can_en_passant;
+	umove->black_can_en_passant = board->black_can_en_passant;
+	board->hash ^= Zobrist_state(board);
+	board->black_can_en_passant = -1;
+	board->white_can_en_passant = -1;
+	board->ply_count++;
+	board->hash ^= Zobrist_state(board) ^ ZOBRIST_BLACK_TO_MOVE;
+	#ifdef DEBUG
+	assert(board->hash == Zobrist_hash(board));
+	assert(board->material == Fitness_material(board));
+	#endif
 }
 
 
+void Board_undo_null_move(Board *board, UndoableMove *umove) {
+	board->white_can_en_passant = umove->white_can_en_passant;
+	board->black_can_en_passant = umove->black_can_en_passant;
+	board->ply_count--;
+	board->hash = umove->hash;
+	#ifdef DEBUG
+	assert(board->hash == Zobrist_hash(board));
+	assert(board->material == Fitness_material(board));
+	#endif
+}
+
 void Board_save(Board *board, const char *filename) {
 	FILE *file = fopen(filename, "w");
 	if (file == NULL) {
@@ -541,7 +557,7 @@ void Board_save(Board *board, const char *filename) {
 		exit(1);
 	}
 	int i,j;
-	Piece *p;
+	const Piece *p;
 	for (j = 0; j < 8; j++) {
 		for (i = 0; i < 8; i++) {
 			p = Board_get_piece(board, i, j);
@@ -603,7 +619,7 @@ Board *Board_read(const char *filename) {
 					fprintf(stderr, "Unexpected EOF!");
 					exit(1);
 				}
-				board->fields[i][j] = Piece_parse(buf);
+				Board_set(board, i, j, Piece_parse(buf));
 			}
 			// Consume newline
 			char newline = fgetc(file);
@@ -639,6 +655,7 @@ Board *Board_read(const char *filename) {
 		board->ply_count = ply;
 		board->fifty_move_count = fif;
 		board->state = state;
+		board->hash = Zobrist_hash(board);
 
 		// Captured pieces
 		for(i = 0; i < cap_white; i++) {
@@ -673,7 +690,7 @@ void Board_add_capture(Board *board, UndoableMove *um) {
 	Board_add_captured_piece(board, um->hit_piece);
 }
 
-void Board_add_captured_piece(Board *board, Piece *piece) {
+void Board_add_captured_piece(Board *board, const Piece *piece) {
 	Capture *c = malloc(sizeof(Capture));
 	c->piece = piece;
 	c->next_sibling = NULL;
@@ -694,7 +711,6 @@ void Board_add_captured_piece(Board *board, Piece *piece) {
 
 void Capture_destroy(Capture *capture) {
 	assert(capture != NULL);
-	Piece_destroy(capture->piece);
 	if (capture->next_sibling != NULL) {
 		Capture_destroy(capture->next_sibling);
 	}
@@ -1,8 +1,10 @@
 #include <stdbool.h>
+#include "bitboard.h"
 #include "common.h"
 #include "datatypes.h"
 #include "fitness.h"
 #include "piece.h"
+#include "zobrist.h"
 
 /**
  * board.h / board.c
@@ -69,8 +71,8 @@ void Board_print_captures(Board *b, int color);
 * Both x and y must lie within the interval [0,7].
 * If the parameters can be outside this range, use getPieceSafe() instead. 
 */
-inline Piece *Board_get_piece(Board *b, int x, int y) {
-	return b->fields[x][y];
+inline const Piece *Board_get_piece(Board *b, int x, int y) {
+	return Piece_from_code(b->fields[x][y]);
 }
 
 /**
@@ -80,11 +82,11 @@ inline Piece *Board_get_piece(Board *b, int x, int y) {
 * If it is priorly known that the specified square is on the board,
 * use getPiece instead for performance.
 */
-inline Piece *Board_get_piece_safe(Board *b, int x, int y) {
+inline const Piece *Board_get_piece_safe(Board *b, int x, int y) {
 	if (x < 0 || x > 7 || y < 0 || y > 7) {
 		return NULL;
 	}
-	return b->fields[x][y];
+	return Piece_from_code(b->fields[x][y]);
 }
 
 /**
@@ -92,7 +94,7 @@ inline Piece *Board_get_piece_safe(Board *b, int x, int y) {
 * Both x and y must lie within the interval [0,7].
 */
 inline bool Board_is_empty(Board *b, int x, int y) {
-	return b->fields[x][y] == NULL;
+	return !Bitboard_has(b->occupancy, x, y);
 }
 
 /**
@@ -109,8 +111,7 @@ inline int Board_evaluate(Board *b) {
 * Use is_at_safe for that.
 */
 inline bool Board_is_at(Board *b, int x, int y, int shape, int color) {
-	Piece *p = Board_get_piece(b, x, y);
-	return p != NULL && Piece_matches(p, shape, color);
+	return Bitboard_has(b->pieces[COLOR_INDEX(color)][shape], x, y);
 }
 
 /**
@@ -119,8 +120,10 @@ inline bool Board_is_at(Board *b, int x, int y, int shape, int color) {
 * the boundaries of the board and if the tile is empty
 */
 inline bool Board_is_at_safe(Board *b, int x, int y, int shape, int color) {
-	Piece *p = Board_get_piece_safe(b, x, y);
-	return p != NULL && Piece_matches(p, shape, color);
+	if (x < 0 || x > 7 || y < 0 || y > 7) {
+		return false;
+	}
+	return Board_is_at(b, x, y, shape, color);
 }
 
 /**
@@ -129,8 +132,7 @@ inline bool Board_is_at_safe(Board *b, int x, int y, int shape, int color) {
 * Does NOT check if the tile is within the boundaries of the board!
 */
 inline bool Board_is_color(Board *b, int x, int y, int color) {
-	Piece *p = Board_get_piece(b, x, y);
-	return p != NULL && p->color == color;
+	return Bitboard_has(b->occupied[COLOR_INDEX(color)], x, y);
 }
 
 /**
@@ -139,23 +141,44 @@ inline bool Board_is_color(Board *b, int x, int y, int color) {
 * Does NOT check if the tile is within the boundaries of the board!
 */
 inline bool Board_is_type(Board *b, int x, int y, int shape) {
-	Piece *p = Board_get_piece(b, x, y);
-	return p != NULL && p->shape == shape;
+	return Bitboard_has(b->pieces[0][shape] | b->pieces[1][shape], x, y);
 }
 
 /**
 * Puts the given piece on position pos=(i,j) on the board.
 * This method assumes that pos is a valid position.
 * The piece may be NULL to put an empty field.
-* <s>The given piece is cloned, so changing the piece after calling this
-* method does not affect the board.</s>
-* 
-* - Piece is NOT cloned. Why should it?
+* Only the piece code is stored, pieces are shared (see Piece_get).
 *
-* - What to do with the occupied field if ! null? Free memory? Clone result?
+* Also updates the bitboards, the hash and the material balance, so this is
+* the only way fields should be changed.
 */
-inline void Board_set(Board *b, int x, int y, Piece *p) {
-	b->fields[x][y] = p;
+inline void Board_set(Board *b, int x, int y, const Piece *p) {
+	Bitboard bit = SQUARE_BIT(x, y);
+	const Piece *old = Piece_from_code(b->fields[x][y]);
+	if (old != NULL) {
+		b->pieces[COLOR_INDEX(old->color)][old->shape] &= ~bit;
+		b->occupied[COLOR_INDEX(old->color)] &= ~bit;
+		b->occupancy &= ~bit;
+	}
+	if (p != NULL) {
+		b->pieces[COLOR_INDEX(p->color)][p->shape] |= bit;
+		b->occupied[COLOR_INDEX(p->color)] |= bit;
+		b->occupancy |= bit;
+	}
+	uint8_t code = (p == NULL ? 0 : PIECE_CODE(p->shape, p->color));
+	b->hash ^= Zobrist_piece(b->fields[x][y], SQUARE(x, y)) ^ Zobrist_piece(code, SQUARE(x, y));
+	b->material += FITNESS_PIECE_VALUE[code] - FITNESS_PIECE_VALUE[b->fields[x][y]];
+	b->fields[x][y] = code;
+}
+
+/**
+ * Returns the square index of the King of the given color,
+ * or -1 if that King is not on the board.
+ */
+inline int Board_king_square(Board *b, int color) {
+	Bitboard king = b->pieces[COLOR_INDEX(color)][KING];
+	return king ? Bitboard_first(king) : -1;
 }
 
 /**
@@ -177,17 +200,36 @@ bool Board_equals(bool quick, Board *left, Board *right);
 /**
 * Adapts the board according to a given move.
 * This function assumes that the parameter is a valid move.
-* Returns an UndoableMove
+* Returns an UndoableMove, which must be freed with Undo_destroy.
 */
 UndoableMove *Board_do_move(Board *board, Move *move);
 
 /**
-* Undoes a move that was done using do_move() and brings the board back to
-* it's original state before that move. Parameter umove is a move
-* describing how to undo a move. This object is usually  returned by do_move.
+* Like Board_do_move, but writes the UndoableMove into `umove`
+* instead of allocating one. Used by the engine, which keeps
+* the UndoableMoves on the stack.
+*/
+void Board_make_move(Board *board, Move *move, UndoableMove *umove);
+
+/**
+* Undoes a move that was done using do_move() or make_move() and brings the
+* board back to it's original state before that move. Parameter umove is a
+* move describing how to undo a move. It is not freed.
 */
 void Board_undo_move(Board *board, UndoableMove *umove);
 
+/**
+* Passes the turn to the other player without moving anything: a 'null
+* move', used by the search. En passant is no longer possible afterwards.
+* The board is restored with Board_undo_null_move, not Board_undo_move.
+*/
+void Board_make_null_move(Board *board, UndoableMove *umove);
+
+/**
+* Undoes a null move done with Board_make_null_move.
+*/
+void Board_undo_null_move(Board *board, UndoableMove *umove);
+
 /**
  * Saves a board to a file
  */
@@ -207,7 +249,7 @@ void Board_add_capture(Board *board, UndoableMove *um);
 /**
  * Adds a piece to the list of captured pieces
  */
-void Board_add_captured_piece(Board *board, Piece *piece);
+void Board_add_captured_piece(Board *board, const Piece *piece);
 
 /**
  * Destroys a Capture object along with the Piece in it.
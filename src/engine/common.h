@@ -28,7 +28,32 @@
 
 // To disable threading it's better to disable #define THREADS
 // than to set the thread count to 0, to remove multithreading overhead.
-#define MAX_THREADS (4)
+// This is the default, it can be changed at runtime with Engine_set_threads,
+// e.g. through the -t option of the command line.
+#define DEFAULT_THREADS (4)
+// With PARALLEL_YBWC (see engine.h), only nodes with at least
+// this remaining depth are searched by several threads
+#define SPLIT_MIN_DEPTH (2)
+
+/*******************************************************************************************
+ * Time management
+ */
+
+// The engine won't start searching one ply deeper after this many seconds
+#define SOFT_TIME_LIMIT (5.0)
+// The engine aborts the search after this many seconds and plays the
+// best move of the deepest search that did finish
+#define HARD_TIME_LIMIT (20.0)
+// Number of moves between checks of the clock, per thread
+#define TIME_CHECK_INTERVAL (1024)
+
+/*******************************************************************************************
+ * Transposition table
+ */
+
+// Size of the table in megabytes, shared by all threads.
+// The number of entries is rounded down to a power of two.
+#define TRANSPOSITION_TABLE_MB (32)
 
 /*******************************************************************************************
  * Options to tweak the algorithm
@@ -38,18 +63,14 @@
 // with -DDEBUG (when using gcc, at least)
 // or building with `make debug`
 #ifndef DEBUG
-	// Minimum ply depth. Except for the standard alpha/beta behaviour,
-	// the search depth will not be altered to be less than this, only deeper.
-	#define __MIN_PLY_DEPTH (5)
-	// If 1, only the moves of the current players are regarded (not the countermoves)
-	// and are NOT evaluated. Quite useless, so always use > 2.
-	// Depth 1 will almost certainly not properly detect when the game has ended, too.
-	#define MAX_PLY_DEPTH (6)
+	// Full width search depth. After that, the quiescence search
+	// goes on with captures until the position is quiet.
+	// Depth 1 will almost certainly not properly detect when the game has ended.
+	#define MAX_PLY_DEPTH (8)
 	// Responses to check do not count as a ply while searching ('check extension'),
 	// to prevent eternal loops, there's a maximum of extensions allowed per search path:
 	#define MAX_EXTRA_PLY_DEPTH (2)
 #else
-	#define __MIN_PLY_DEPTH (3)
 	#define MAX_PLY_DEPTH (3)
 	#define MAX_EXTRA_PLY_DEPTH (0)
 	// Prints the reasoning behind evaluation
@@ -76,22 +97,40 @@
 #define MIN_FITNESS (-1000000)
 // Maximum fitness that a board evaluation can produce. Means white wins.
 #define MAX_FITNESS (1000000)
-// When the mininum ply depth is X, this value should be MAX_PLY_DEPTH - X
-#define MIN_PLY_DEPTH_REMAINDER (MAX_PLY_DEPTH - __MIN_PLY_DEPTH)
 // Max ply depth used when calculating for the opening book
-// Minimum ply depth will be OPENING_BOOK_MAX_PLY_DEPTH - MIN_PLY_DEPTH_REMAINDER
 // Not used at the moment.
 #define OPENING_BOOK_MAX_PLY_DEPTH (5)
-// If a branch of moves has a quiescence score that is above the threshold,
-// it won't be branched at the minimum ply depth. 
-#define QUIESCENCE_THRESHOLD (100)
-// A move adds this many 'points' to its score when it is a capture 
-#define QUIESCENCE_PENALTY_CAPTURE (100)
-// A move adds this many 'points' to its score when a piece is pinned
-//#define QUIESCENCE_PENALTY_PINNED (60)
-// A move adds this many 'points' to its score when a piece is 'hanging'
-// (i.e. attacked and not covered)
-//#define QUIESCENCE_PENALTY_HANGING (60)
+// Number of best moves shown when analysing a position, unless told otherwise
+#define ANALYSIS_LINES (3)
+// The quiescence search stops this many plies past the full width search,
+// even if the position is still not quiet. Only long series of checks get there.
+#define MAX_QUIESCENCE_PLY_DEPTH (16)
+// Delta pruning: a capture is skipped in the quiescence search when even
+// winning the piece and this margin can't bring the score up to the bound.
+#define DELTA_MARGIN (200)
+// Null-move pruning: the side to move passes, and the opponent gets a search
+// this many plies shallower than usual. Only at this remaining depth or more.
+#define NULL_MOVE_REDUCTION (2)
+#define NULL_MOVE_MIN_DEPTH (3)
+// Late move reductions: quiet moves after the first LMR_MIN_MOVES are searched
+// a ply shallower, after LMR_MANY_MOVES two plies. Only at LMR_MIN_DEPTH or more.
+#define LMR_MIN_DEPTH (3)
+#define LMR_MIN_MOVES (3)
+#define LMR_MANY_MOVES (8)
+// Pruning near the leaves, at a remaining depth of at most FUTILITY_MAX_DEPTH.
+// The material balance (Board.material) serves as a quick estimate of the
+// evaluation, the margins per ply of remaining depth leave room for the rest
+// of the evaluation and for what the moves may win.
+#define FUTILITY_MAX_DEPTH (3)
+// Futility pruning: quiet moves are skipped when the estimate plus the margin can't reach the bound
+#define FUTILITY_MARGIN (200)
+// Reverse futility pruning: the node is cut off when the estimate minus the margin still beats the bound
+#define REVERSE_FUTILITY_MARGIN (200)
+// Razoring: when the estimate plus the margin can't reach the bound, the quiescence search decides
+#define RAZOR_MARGIN (350)
+// Aspiration windows: each iteration of the search starts with a window this
+// wide on either side of the score of the previous iteration.
+#define ASPIRATION_WINDOW (50)
 // Evaluate moves in random order. Useful for unpredictability,
 // but cannot be used when alpha/beta in root level
 #define MOVE_RANDOMIZE (false)
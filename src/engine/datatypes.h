@@ -49,6 +49,10 @@
 #define RANK_7 1
 #define RANK_8 0
 
+/**
+ * A set of squares, one bit per square. See bitboard.h.
+ */
+typedef uint64_t Bitboard;
 
 /**
  * Simple representation of a piece of the chess set, defined
@@ -56,6 +60,9 @@
  * The symbol is the character used when displaying the piece.
  * Color is either BLACK or WHITE.
  * Shape is either PAWN, KNIGHT, BISHOP, ROOK, QUEEN or KING
+ *
+ * There are only twelve Pieces, shared by all boards (see Piece_get).
+ * They must never be changed or freed.
  */
 typedef struct Piece {
 	int color;
@@ -70,7 +77,7 @@ typedef struct Piece {
  */
 typedef struct Capture {
 	/// The captured piece
-	Piece *piece;
+	const Piece *piece;
 	/// The next piece in the list, or NULL
 	struct Capture *next_sibling;
 } Capture;
@@ -83,7 +90,7 @@ typedef struct Capture {
 typedef struct Square {
 	int x;
 	int y;
-	Piece *piece;
+	const Piece *piece;
 	/// When creating a list of squares, this'll point to the next in line.
 	struct Square *next_sibling;
 } Square;
@@ -95,7 +102,25 @@ typedef struct Square {
  */
 typedef struct Board {
 
-	Piece *fields[8][8];
+	/// Piece codes (see PIECE_CODE in piece.h), 0 for empty fields.
+	/// Use Board_get_piece and Board_set instead of accessing this directly.
+	uint8_t fields[8][8];
+
+	/// Bitboards of the pieces, indexed by [color][shape] (see COLOR_INDEX in bitboard.h).
+	/// Always in sync with `fields`, as long as fields are changed through Board_set.
+	Bitboard pieces[2][6];
+	/// All pieces of a single color, indexed like `pieces`
+	Bitboard occupied[2];
+	/// All pieces on the board
+	Bitboard occupancy;
+
+	/// Zobrist hash of the position, including side to move,
+	/// castling and en passant. See zobrist.h.
+	uint64_t hash;
+
+	/// Material balance, see Fitness_material. Like the hash, it is kept
+	/// up to date by Board_set, so it is a quick estimate of the evaluation.
+	int material;
 
 	/// Number of half-moves completed
 	uint8_t ply_count;
@@ -158,6 +183,20 @@ typedef struct Move {
 } Move;
 
 
+/// Room for the moves of any position; the most found in a legal position is 218.
+#define MAX_MOVES 256
+
+/**
+ * A list of moves in their compact 32-bit form (see MOVE_CODE in move.h).
+ * Has a fixed capacity so it can live on the stack, meaning the engine can
+ * generate moves without allocating anything.
+ */
+typedef struct MoveList {
+	uint32_t moves[MAX_MOVES];
+	int count;
+} MoveList;
+
+
 /**
  * The opposite of a Move.
  * When a move is performed on a Board, the resulting UndoableMove
@@ -168,16 +207,18 @@ typedef struct UndoableMove {
 	uint8_t x, y;
 	uint8_t xx, yy;
 	uint8_t hit_y;
-	Piece *hit_piece;
+	const Piece *hit_piece;
 	bool adds_to_fifty;
 	bool white_can_castle_queens_side;
 	bool white_can_castle_kings_side;
 	bool black_can_castle_queens_side;
 	bool black_can_castle_kings_side;
-	bool white_can_en_passant;
-	bool black_can_en_passant;
+	uint8_t white_can_en_passant;
+	uint8_t black_can_en_passant;
 	bool is_promotion;
 	bool is_castling;
+	/// Board.hash before the move
+	uint64_t hash;
 	/// If undoable moves are kept in a list, this'll point to the previous half-move
 	struct UndoableMove *previous;
 } UndoableMove;
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include "algebraicnotation.h"
 #include "board.h"
 #include "color.h"
 #include "common.h"
@@ -11,14 +12,28 @@
 #include "fitness.h"
 #include "heuristics.h"
 #include "move.h"
+#include "picker.h"
 #include "piece.h"
+#include "pool.h"
+#include "transposition.h"
 #include "validator.h"
 
 #ifdef THREADS
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #endif
 
+/**
+ * What alpha_beta found out about a position: the eventual board position value,
+ * and the state it's in, i.e. WHITE_WINS or BLACK_WINS if it's check mate,
+ * STALE_MATE if it's stale mate and UNFINISHED otherwise.
+ */
+typedef struct Outcome {
+	int fitness;
+	int state;
+} Outcome;
+
 /**
  * Simple struct for passing a chunk of moves
  * to a thread
@@ -28,11 +43,76 @@ typedef struct ThreadData {
 	Stats *stats;	/// Output: chunk statistics
 	int color;		/// Who's turn it is
 	int ply_depth;	/// Max ply depth
-	Move **head;	/// List of moves
-	int from;		/// Index of move to start at (in **head)
-	int to;			/// Index+1 of move to stop at (in **head)
+	MoveList *moves;	/// List of moves
+	int *fitness;	/// Output: evaluation of each move in the list
+	int *state;		/// Output: game state each move leads to, e.g. WHITE_WINS
+	Variation *lines;	/// Output: principal variation of each move
+	int from;		/// Index of move to start at (in moves)
+	int to;			/// Index+1 of move to stop at (in moves)
+	int multi_pv;	/// Number of best moves that need an exact evaluation
+	int *alpha;		/// Root alpha, shared by all threads
+	int *beta;		/// Root beta, shared by all threads
+	Heuristics *heuristics;	/// Move ordering heuristics of the thread
+	bool helper;	/// Lazy SMP helper, doesn't report progress
 } ThreadData;
 
+#ifdef THREADS
+/**
+ * Work for the thread pool at the root of the search: a chunk of the moves
+ * (PARALLEL_ROOT_SPLIT) or the search of a lazy SMP helper. The worker that
+ * runs it searches on its own board, stats and heuristics.
+ */
+typedef struct RootTask {
+	Task task;			/// For the pool, must be the first member
+	ThreadData data;	/// Passed to evaluate_moves
+	Board *root;		/// Position to copy, doesn't change while the task runs
+	int *pending;		/// Number of unfinished tasks, decremented when done
+} RootTask;
+
+/**
+ * A lazy SMP helper: searches the whole list of moves,
+ * in its own order, deepening on its own.
+ */
+typedef struct Helper {
+	RootTask root_task;			/// Must be the first member
+	Board board;				/// Position to search, the main thread changes the original
+	MoveList moves;				/// Own copy of the moves
+	int fitness[MAX_MOVES];		/// Evaluation of each move
+	int state[MAX_MOVES];		/// Game state each move leads to
+	Variation lines[MAX_MOVES];	/// Principal variation of each move
+	int first_depth;			/// Ply depth of the first iteration
+} Helper;
+
+/**
+ * A node of which the remaining moves are searched by several threads at once.
+ * Following the Young Brothers Wait Concept, a node is only split after its
+ * first move has been searched, which usually gives good bounds for the rest.
+ * The split point is put in the deque of the thread that owns the node, where
+ * idle threads can steal it. It lives on the stack of the owner, which waits
+ * until no other thread refers to it anymore.
+ */
+typedef struct SplitPoint {
+	Task task;				/// For the pool, must be the first member
+	Board board;			/// Position at the node, copied by the helpers
+	MoveList *moves;		/// Moves of the node, owned by the owner
+	int dist;				/// Parameters of the node, see alpha_beta
+	int depth;
+	int extra_depth;
+	bool at_check;
+	int color;
+	int searched;			/// Number of moves searched before splitting
+	pthread_mutex_t lock;	/// Protects the fields below
+	int next;				/// Index of the next move that is to be searched
+	int alpha;				/// Bounds, tightened by all threads
+	int beta;
+	uint32_t best_move;		/// Move that tightened the bounds last
+	uint32_t pv[HEURISTICS_MAX_DIST + 1];	/// Principal variation of the node, see Heuristics.pv
+	int pv_length;
+	bool cutoff;			/// The node has a cut-off, stop searching
+	int references;			/// Number of threads and deque entries referring to this
+} SplitPoint;
+#endif
+
 /**
  * Prints an indent suitable for the current search depth.
  * Used when printing a tree of available moves and counter moves.
@@ -52,20 +132,58 @@ static void print_depth(int depth) {
 #endif
 
 /**
- * Returns the best move from the given list of moves. The given list
- * of moves <strong>must be usable as an array</strong>, like so:
- * 	head[0]->fitness = 0; head[1]->fitness = 0; // etc.
- * <strong>So a list of individual moves linked together by their ->next_sibling is NOT ok.</strong>
- * The length of the list must be specified in the last parameter.
+ * Returns the index of the best move in the given list of moves.
+ * The evaluation of each move is written to `fitness`, the game
+ * state it leads to (mate, stale mate) to `state`, and the line the
+ * search expects after it to `lines`. They must have room for all
+ * moves in the list. The search starts with the window
+ * `alpha`..`beta`: if the best move isn't inside it, its value is only
+ * a bound, see Engine_turn.
  * 
  * The list of moves is send in chunks to evaluate_moves after which the
- * move with best value is picked (or randomly one of the moves within 10% 'distance'
- * from the best move).
+ * move with best value is picked.
  * 
  * If multithreading is disabled this method straight up just calls
  * evaluate_moves with all the parameters wrapped in a ThreadData object.
  */
-static Move *get_best_move(Board *board, Stats *stats, int color, int ply_depth, Move **head, int total);
+static int get_best_move(Board *board, Stats *stats, int color, int ply_depth, MoveList *moves, int *fitness, int *state, Variation *lines, int alpha, int beta);
+
+#ifdef THREADS
+/**
+ * Lazy SMP: hands `count` helper searches to the pool, that search the same
+ * moves as the main thread without coordination. Their results are ignored,
+ * but they fill the shared transposition table. The helpers start at
+ * alternating depths, and each searches the root moves in a different order.
+ */
+static void start_helpers(Helper *helpers, int count, int *pending, Board *board, int color, int ply_depth, MoveList *moves);
+
+/**
+ * Stops the helpers started by start_helpers and waits for them.
+ */
+static void stop_helpers(int *pending);
+
+/**
+ * Task function of a chunk of root moves.
+ */
+static void run_chunk(Task *task, Worker *worker);
+
+/**
+ * Task function of a lazy SMP helper: iterative deepening on its own.
+ */
+static void run_helper(Task *task, Worker *worker);
+
+/**
+ * Points the task to the board, stats and heuristics of the worker,
+ * and puts the root position on the board.
+ */
+static void prepare_root_task(RootTask *task, Worker *worker);
+
+/**
+ * Runs the calling thread's own tasks that weren't stolen,
+ * then waits until all pending tasks are done.
+ */
+static void wait_for_tasks(int *pending);
+#endif
 
 /**
  * Evaluates given moves by calling the alpha-beta algorithm on each of them.
@@ -81,32 +199,126 @@ static Move *get_best_move(Board *board, Stats *stats, int color, int ply_depth,
  * - *board 	- the board to perform a move on. Must be reset to it's original state before finishing.
  * - *stats 	- performance stats, will be adjusted.
  * - dist 		- distance from root. Like the reverse of depth
- * - depth 		- remaining ply depth. When combined with extra_depth this is below minimum,
- * 				  the search will not branch further.
- * - extra depth- when quiescence score determines that a deeper search is reguired,
- *				  the value of this paramter is increased.
- * - quiescence_score
- * 				- indicates if the current branch is 'quiet' or not. When this value is above a
- *                certain threshold the branch is considered volatile and will be
- *  			  searched a bit deeper.
+ * - depth 		- remaining ply depth. When combined with extra_depth this reaches zero,
+ * 				  the quiescence search takes over.
+ * - extra depth- plies added to the search because of check (check extension).
  * - alpha 		- alpha cutoff value
  * - beta 		- beta cutoff value
  * - color 		- current turn
- * - *killers	- array with pointers to killer moves.
+ * - *heuristics - move ordering heuristics of the thread.
  *
- * Returns an array: {fitness, state} where fitness is the eventual board position value
- * and state is either 1 if the move results directly in check mate, 2 if it directly
- * results in stale mate, and 0 otherwise.
+ * Returns the Outcome by value, so that several threads can search at the same time.
+ * Only if the position itself is check mate or stale mate its state is not UNFINISHED.
  */
-static int * alpha_beta(Board *board, Stats *stats, int dist, int depth, int extra_depth, int quiescence_score, int alpha, int beta, int color, unsigned int killers[]);
+static Outcome alpha_beta(Board *board, Stats *stats, int dist, int depth, int extra_depth, int alpha, int beta, int color, Heuristics *heuristics);
 
 /**
- * Creates an array of pointers to the moves, so that
- * they can be accessed as: *first, *(first+1), *(first+2), ... *(first+total-1).
- * Or as *first, *first[1], etc., I think.
- * The array is shuffled and put into the first parameter.
+ * Searches only captures and promotions, until the position is quiet, so the
+ * leaves of alpha_beta aren't evaluated in the middle of an exchange.
+ * The side to move may also 'stand pat': keep the static evaluation instead
+ * of capturing. When at check there is no standing pat, and all moves are
+ * searched instead. Parameters are like those of alpha_beta, `qdist` is the
+ * number of plies into the quiescence search.
  */
-static void create_shuffled_array(Move **out, Move *head, int total);
+static Outcome quiescence(Board *board, Stats *stats, int qdist, int alpha, int beta, int color);
+
+/**
+ * Performs a move, searches the resulting position with alpha_beta and undoes the move.
+ * The parameters are those of the node the move is made in; `at_check` tells if `color`
+ * is at check there, which extends the search.
+ */
+static Outcome search_move(Board *board, Stats *stats, int dist, int depth, int extra_depth, bool at_check, int alpha, int beta, int color, Heuristics *heuristics, uint32_t code);
+
+/**
+ * Like search_move, for the move that comes after `index` other moves in the move
+ * order. Principal variation search: only the first move (index 0) is searched with
+ * the full window. The others are expected to be worse, which a search with a null
+ * window around the bound proves much quicker. Only a move that turns out to beat
+ * the bound is searched again with the full window.
+ *
+ * A quiet move that comes late in the move order is first searched less deep as well
+ * (late move reduction). Moves that capture, give check or are killer moves are never
+ * reduced, and neither are the moves when at check.
+ */
+static Outcome search_late_move(Board *board, Stats *stats, int dist, int depth, int extra_depth, bool at_check, int alpha, int beta, int color, Heuristics *heuristics, uint32_t code, int index);
+
+/**
+ * Tells if the side to move has other pieces than pawns and the King. Without
+ * them it is often in zugzwang, where passing would be better than any move,
+ * so null-move pruning would be wrong.
+ */
+static bool has_pieces(Board *board, int color);
+
+#ifdef THREADS
+/**
+ * Tells if a node with the given remaining depth should be split,
+ * i.e. if it has enough work left to share with other threads.
+ * It also needs at least two moves left, see alpha_beta.
+ */
+static bool should_split(int draft);
+
+/**
+ * Searches the remaining moves of the split point together with any thread that
+ * steals it. Only returns when all of them are done. The results are in the
+ * split point's bounds, best move and cut-off flag.
+ */
+static void split(SplitPoint *sp, Board *board, Stats *stats, Heuristics *heuristics);
+
+/**
+ * Takes moves of the split point and searches them, until there are none left.
+ * Used by the owner and the helpers alike.
+ */
+static void search_split_point(SplitPoint *sp, Board *board, Stats *stats, Heuristics *heuristics);
+
+/**
+ * Task function of a SplitPoint, run by a thread that stole it.
+ */
+static void help_split_point(Task *task, Worker *worker);
+
+/**
+ * Like Heuristics_pv_update, for the principal variation of the split point,
+ * with the line found by the thread that searched the move.
+ * Must be called with the lock of the split point held.
+ */
+static void update_split_point_pv(SplitPoint *sp, Heuristics *heuristics, uint32_t code);
+#endif
+
+/**
+ * Atomically raises the shared bound to `value` if that is higher.
+ * Returns the new bound.
+ */
+static int raise_bound(int *bound, int value);
+
+/**
+ * Atomically lowers the shared bound to `value` if that is lower.
+ * Returns the new bound.
+ */
+static int lower_bound(int *bound, int value);
+
+/**
+ * Shuffles the list of moves, so the engine doesn't
+ * always pick the first of several equally good moves.
+ */
+static void shuffle_moves(MoveList *moves);
+
+/**
+ * Sorts the moves from best to worst for the given color, using the evaluations
+ * of the previous iteration. The sort is stable, so moves that were cut off
+ * (and all got the same value) stay in the same order. Fitness, state
+ * and lines are sorted along with the moves.
+ */
+static void sort_moves(MoveList *moves, int *fitness, int *state, Variation *lines, int color);
+
+/**
+ * Returns a wall clock time stamp in seconds.
+ */
+static double wall_time();
+
+/**
+ * Returns true if the search must stop as soon as possible. Every
+ * TIME_CHECK_INTERVAL moves this also checks if the deadline has passed.
+ */
+static bool out_of_time(Stats *stats);
 
 /**
  * Wether or not to print progress.
@@ -114,12 +326,64 @@ static void create_shuffled_array(Move **out, Move *head, int total);
  */
 static int draw_progress = true;
 
+/// Time budget per turn in seconds, see Engine_set_time_limit
+static double soft_time_limit = SOFT_TIME_LIMIT;
+static double hard_time_limit = HARD_TIME_LIMIT;
+
+/// Wall time at which the search must be aborted, 0 when it must not be aborted.
+/// Set by Engine_turn while lazy SMP helpers may be searching, so it is
+/// read and written atomically, like stop_search.
+static double deadline = 0;
+
+/// Set when the deadline has passed. Polled by all search threads,
+/// which then return right away with an unusable result.
+static int stop_search = false;
+
+/// Number of best moves to find the exact evaluation of, see Engine_set_multi_pv
+static int multi_pv = 1;
+
+/// Principal variations of the best moves of the last finished iteration,
+/// best first, see Engine_variations
+static Variation best_lines[MAX_MOVES];
+static int best_line_count = 0;
+
+/// Move ordering heuristics of the search when it runs on this thread
+/// alone. The workers of the pool have their own.
+static Heuristics serial_heuristics;
+
+/// Number of threads and the way they work together, see Engine_set_threads
+static int thread_count = DEFAULT_THREADS;
+static int parallel_mode = PARALLEL_ROOT_SPLIT;
 
-Move *Engine_turn(Board *board, Stats *stats, int color, int ply_depth, int verbosity) {
-	clock_t start_time, stop_time;
-	start_time = clock();
+void Engine_set_time_limit(double soft, double hard) {
+	soft_time_limit = soft;
+	hard_time_limit = hard;
+}
+
+void Engine_set_threads(int threads, int mode) {
+	thread_count = max(1, threads);
+	parallel_mode = mode;
+}
+
+void Engine_set_multi_pv(int count) {
+	multi_pv = max(1, min(MAX_MOVES, count));
+}
+
+int Engine_variations(Variation *out, int max) {
+	int count = min(max, best_line_count);
+	int i;
+	for (i = 0; i < count; i++) {
+		out[i] = best_lines[i];
+	}
+	return count;
+}
+
+
+Move *Engine_turn(Board *board, Stats *stats, int color, int ply_depth, int verbosity, Variation *pv) {
 	// Housekeeping
 	draw_progress = verbosity != 0;
+	// The tables of the Heuristics, and the Variations, have no room for more
+	ply_depth = min(ply_depth, MAX_PLY_DEPTH);
 	if (verbosity >= 2) {
 		printf("Thinking");
 		#ifdef PRINT_THINKING
@@ -128,42 +392,188 @@ Move *Engine_turn(Board *board, Stats *stats, int color, int ply_depth, int verb
 	}
 	// Init randomizer:
 	srand(time(NULL));
+	// Older results in the transposition table may be replaced first:
+	Transposition_new_search();
 	// Generate list of all valid moves:
-	Move *head = Move_alloc();
-	int total = v_get_all_valid_moves_for_color(&head, board, color);
+	MoveList moves;
+	int total = v_get_moves(&moves, board, color);
+	best_line_count = 0;
+	if (total == 0) {
+		if (pv != NULL) {
+			pv->length = 0;
+		}
+		return NULL;
+	}
+	Move *result = Move_alloc();
 	// No reason to evaluate forced moves:
 	if (total == 1) {
 		if (PRINT_STATS || verbosity > 1) {
 			printf("Only one move possible, no moves evaluated.\n");
 		}
-		return head;
+		Move_decode(moves.moves[0], result);
+		result->fitness = (color == WHITE ? MIN_FITNESS : MAX_FITNESS);
+		best_lines[0].fitness = result->fitness;
+		best_lines[0].length = 1;
+		best_lines[0].moves[0] = moves.moves[0];
+		best_line_count = 1;
+		if (pv != NULL) {
+			*pv = best_lines[0];
+		}
+		return result;
+	}
+	shuffle_moves(&moves);
+	// Find the best move, by searching one ply deeper every iteration.
+	// The best move of the previous iteration is searched first, and the
+	// transposition table holds the best replies found so far, which makes
+	// the cut-offs of the next iteration come early.
+	int fitness[MAX_MOVES];
+	int state[MAX_MOVES];
+	Variation lines[MAX_MOVES];
+	// Index of the worst of the moves that need an exact evaluation
+	int last = min(multi_pv, total) - 1;
+	// Result of the last finished iteration. The moves are reordered by
+	// every pass of the search, also by one that is aborted later on.
+	uint32_t best_move = 0;
+	int best_fitness = 0;
+	int best_state = UNFINISHED;
+	int depth, i;
+	double search_start = wall_time();
+	// The first iteration always finishes, so there is a move to return
+	double limit = 0;
+	__atomic_store(&deadline, &limit, __ATOMIC_RELAXED);
+	__atomic_store_n(&stop_search, false, __ATOMIC_RELAXED);
+	// Heuristics of earlier turns count less:
+	Heuristics_age(&serial_heuristics);
+	#ifdef THREADS
+	// The threads are created once, and wait for work between searches
+	if (thread_count > 1) {
+		if (Pool_size() != thread_count) {
+			Pool_init(thread_count);
+		}
+		for (i = 0; i < thread_count; i++) {
+			// Nobody else touches them while the workers sleep
+			Heuristics_age(&Pool_worker(i)->heuristics);
+		}
+		Pool_start();
+	}
+	// In lazy SMP mode this thread does the search on its own, with helpers
+	int helper_count = (parallel_mode == PARALLEL_LAZY_SMP ? thread_count - 1 : 0);
+	Helper *helpers = malloc(helper_count * sizeof(Helper));
+	int helpers_pending = helper_count;
+	start_helpers(helpers, helper_count, &helpers_pending, board, color, ply_depth, &moves);
+	#endif
+	for (depth = 1; depth <= ply_depth; depth++) {
+		if (depth > 1) {
+			// Don't start an iteration that likely won't finish in time
+			if (soft_time_limit > 0 && wall_time() - search_start >= soft_time_limit) {
+				break;
+			}
+			if (hard_time_limit > 0) {
+				limit = search_start + hard_time_limit;
+				__atomic_store(&deadline, &limit, __ATOMIC_RELAXED);
+			}
+		}
+		int moves_before = stats->moves_count;
+		// Aspiration window: expect scores close to those of the previous
+		// iteration, which gives more cut-offs. If a score of the best moves
+		// turns out to be outside the window, search again with a wider window
+		// on that side.
+		int delta = ASPIRATION_WINDOW;
+		int alpha = MIN_FITNESS;
+		int beta = MAX_FITNESS;
+		if (depth > 1) {
+			alpha = max(MIN_FITNESS, min(fitness[0], fitness[last]) - delta);
+			beta = min(MAX_FITNESS, max(fitness[0], fitness[last]) + delta);
+		}
+		while (true) {
+			get_best_move(board, stats, color, depth, &moves, fitness, state, lines, alpha, beta);
+			if (__atomic_load_n(&stop_search, __ATOMIC_RELAXED)) {
+				break;
+			}
+			// Put the best moves first, for the next search and for the result
+			sort_moves(&moves, fitness, state, lines, color);
+			delta *= 2;
+			if (min(fitness[0], fitness[last]) <= alpha && alpha > MIN_FITNESS) {
+				alpha = max(MIN_FITNESS, alpha - delta);
+			} else if (max(fitness[0], fitness[last]) >= beta && beta < MAX_FITNESS) {
+				beta = min(MAX_FITNESS, beta + delta);
+			} else {
+				break;
+			}
+		}
+		if (__atomic_load_n(&stop_search, __ATOMIC_RELAXED)) {
+			// Aborted, keep the result of the previous iteration
+			if (PRINT_STATS || verbosity > 1) {
+				printf(" depth %d: out of time after %.2f seconds.\n", depth, wall_time() - search_start);
+			}
+			break;
+		}
+		best_move = moves.moves[0];
+		best_fitness = fitness[0];
+		best_state = state[0];
+		best_line_count = last + 1;
+		for (i = 0; i < best_line_count; i++) {
+			best_lines[i] = lines[i];
+		}
+		if (PRINT_STATS || verbosity > 1) {
+			Move move;
+			Move_decode(moves.moves[0], &move);
+			printf(" depth %d: ", depth);
+			Move_print_color(&move, color);
+			char *line = AN_format_line(board, lines[0].moves, lines[0].length);
+			printf(", evaluation: %d, %d moves in %.2f seconds, line: %s\n",
+				fitness[0], stats->moves_count - moves_before,
+				wall_time() - search_start, line);
+			free(line);
+			for (i = 1; i < best_line_count; i++) {
+				line = AN_format_line(board, lines[i].moves, lines[i].length);
+				printf("          evaluation: %d, line: %s\n", fitness[i], line);
+				free(line);
+			}
+		}
+		// No need to search deeper once a mate has been found,
+		// for each of the moves that need an exact evaluation
+		if (state[last] == WHITE_WINS || state[last] == BLACK_WINS
+				|| fitness[last] == MIN_FITNESS || fitness[last] == MAX_FITNESS) {
+			break;
+		}
 	}
-	// Make array and shuffle it:
-	Move **arr = malloc(sizeof(Move) * total);
-	create_shuffled_array(arr, head, total);
-	// Find the best move:
-	head = get_best_move(board, stats, color, ply_depth, arr, total);
+	#ifdef THREADS
+	stop_helpers(&helpers_pending);
+	free(helpers);
+	if (thread_count > 1) {
+		Pool_stop(stats);
+	}
+	#endif
+	limit = 0;
+	__atomic_store(&deadline, &limit, __ATOMIC_RELAXED);
 	if (PRINT_STATS || verbosity > 1) {
-		stop_time = clock();
-		double duration = ((double) (stop_time - start_time)) / CLOCKS_PER_SEC;
-		duration /= MAX_THREADS;
+		double duration = wall_time() - search_start;
 		printf("\nEvaluated %d positions and %d moves in %.2f seconds.\n",
 			stats->boards_evaluated, stats->moves_count,
 			duration);
 	}
-	// Make a copy, so the rest can easily be destroyed in 1 go:
-	Move *result = Move_clone(head);
-	Move_destroy(arr[0]);
+	Move_decode(best_move, result);
+	result->fitness = best_fitness;
+	result->gives_check_mate = (best_state == WHITE_WINS || best_state == BLACK_WINS);
+	result->gives_draw = (best_state == STALE_MATE);
+	if (pv != NULL) {
+		*pv = best_lines[0];
+	}
 	return result;
 }
 
 
-static Move *get_best_move(Board *board, Stats *stats, int color, int ply_depth, Move **head, int total) {
+static int get_best_move(Board *board, Stats *stats, int color, int ply_depth, MoveList *moves, int *fitness, int *state, Variation *lines, int alpha, int beta) {
+	int total = moves->count;
 	int i;
 	int threads;
-// If threading is disabled, we use 0 threads, obviously
+	// A good move found by one thread helps the others prune,
+	// through `alpha` and `beta`.
+// If threading is disabled, we use 0 threads, obviously.
+// With lazy SMP the threads don't divide the moves, they each do all.
 #ifdef THREADS
-	threads = MAX_THREADS;
+	threads = (parallel_mode == PARALLEL_ROOT_SPLIT && thread_count > 1 ? thread_count : 0);
 #else
 	threads = 0;
 #endif
@@ -175,9 +585,17 @@ static Move *get_best_move(Board *board, Stats *stats, int color, int ply_depth,
 		data.stats = stats;
 		data.color = color;
 		data.ply_depth = ply_depth;
-		data.head = head;
+		data.moves = moves;
+		data.fitness = fitness;
+		data.state = state;
+		data.lines = lines;
 		data.from = 0;
-		data.to = total - 1;
+		data.to = total;
+		data.multi_pv = multi_pv;
+		data.alpha = &alpha;
+		data.beta = &beta;
+		data.heuristics = &serial_heuristics;
+		data.helper = false;
 		evaluate_moves(&data);
  	}
 
@@ -187,54 +605,140 @@ static Move *get_best_move(Board *board, Stats *stats, int color, int ply_depth,
  	else {
 		// Divide array in chunks and evaluate moves in parallel.
 		int chunks = min(threads, max(1, total/2));
-		ThreadData data[chunks];
-		pthread_t thread[chunks];
+		RootTask tasks[chunks];
+		int pending = chunks;
 	    // Rounding up the number of tasks per thread, which is useful
 	    // in case total does not divide evenly by chunks.
 		int chunk_size = (total + chunks - 1) / chunks;
-		// Divide work
+		// Divide work. The board, stats and heuristics are those of
+		// the thread that runs the chunk, see prepare_root_task.
 		for (i = 0; i < chunks; i++) {
-			data[i].board = Board_clone(board);
-			data[i].stats = calloc(0, sizeof(Stats));
-			data[i].color = color;
-			data[i].ply_depth = ply_depth;
-			data[i].head = head;
-			data[i].from = i * chunk_size;
-			data[i].to = (i+1) * chunk_size;
+			tasks[i].task.run = run_chunk;
+			tasks[i].root = board;
+			tasks[i].pending = &pending;
+			tasks[i].data.color = color;
+			tasks[i].data.ply_depth = ply_depth;
+			tasks[i].data.moves = moves;
+			tasks[i].data.fitness = fitness;
+			tasks[i].data.state = state;
+			tasks[i].data.lines = lines;
+			tasks[i].data.from = i * chunk_size;
+			tasks[i].data.to = (i+1) * chunk_size;
+			tasks[i].data.multi_pv = multi_pv;
+			tasks[i].data.alpha = &alpha;
+			tasks[i].data.beta = &beta;
+			tasks[i].data.helper = false;
 		}
 		// Last one must not go past the end:
-		data[chunks-1].to = total;
-		// Do each chunk
-	    for (i = 0; i < chunks; i++) {
-	        // Launch thread
-	        pthread_create(&thread[i], NULL, evaluate_moves, (void *) &data[i]);
-	    }
-	    // Wait for threads to finish
-	    for (i = 0; i < chunks; i++) {
-	        pthread_join(thread[i], NULL);
-	    }
-	    // Combine statistics
-	    for (i = 0; i < chunks; i++) {
-	        stats->moves_count += data[i].stats->moves_count;
-	        stats->boards_evaluated += data[i].stats->boards_evaluated;
-	        // Board_destroy destroys the pieces as well, so:
-	        Board_destroy(data[i].board);
-	    }
+		tasks[chunks-1].data.to = total;
+		// Hand out the other chunks to the pool, and do the first one here
+		Worker *self = Pool_self();
+		for (i = 1; i < chunks; i++) {
+			Pool_push(self, &tasks[i].task);
+		}
+		run_chunk(&tasks[0].task, self);
+		wait_for_tasks(&pending);
 	}
 #endif
 
 	// Find the highest item:
 	int white = (color == WHITE);
 	int best = 0;
-	for(i = 1; i < total - 1; i++) {
-		if (white == (head[i]->fitness > head[best]->fitness)) {
+	for(i = 1; i < total; i++) {
+		if (white == (fitness[i] > fitness[best])) {
 			best = i;
 		}
 	}
-	return head[best];
+	return best;
 }
 
 
+#ifdef THREADS
+static void start_helpers(Helper *helpers, int count, int *pending, Board *board, int color, int ply_depth, MoveList *moves) {
+	Worker *self = Pool_self();
+	int i, j;
+	for (i = 0; i < count; i++) {
+		Helper *helper = &helpers[i];
+		// Rotate the moves, so the helpers start at different moves
+		helper->moves.count = moves->count;
+		for (j = 0; j < moves->count; j++) {
+			helper->moves.moves[j] = moves->moves[(j + i + 1) % moves->count];
+		}
+		helper->first_depth = 1 + i % 2;
+		RootTask *task = &helper->root_task;
+		helper->board = *board;
+		task->task.run = run_helper;
+		task->root = &helper->board;
+		task->pending = pending;
+		task->data.color = color;
+		task->data.ply_depth = ply_depth;
+		task->data.moves = &helper->moves;
+		task->data.fitness = helper->fitness;
+		task->data.state = helper->state;
+		task->data.lines = helper->lines;
+		task->data.from = 0;
+		task->data.to = moves->count;
+		task->data.multi_pv = multi_pv;
+		task->data.helper = true;
+		Pool_push(self, &task->task);
+	}
+}
+
+static void stop_helpers(int *pending) {
+	// The main search is done, abort the helpers the same way as
+	// when time runs out. The flag is reset by the next Engine_turn.
+	// Without helpers there may not even be a pool.
+	if (__atomic_load_n(pending, __ATOMIC_ACQUIRE) == 0) {
+		return;
+	}
+	__atomic_store_n(&stop_search, true, __ATOMIC_RELAXED);
+	wait_for_tasks(pending);
+}
+
+static void run_chunk(Task *task, Worker *worker) {
+	RootTask *chunk = (RootTask *) task;
+	prepare_root_task(chunk, worker);
+	evaluate_moves(&chunk->data);
+	__atomic_sub_fetch(chunk->pending, 1, __ATOMIC_RELEASE);
+}
+
+static void run_helper(Task *task, Worker *worker) {
+	Helper *helper = (Helper *) task;
+	ThreadData *data = &helper->root_task.data;
+	prepare_root_task(&helper->root_task, worker);
+	int max_depth = data->ply_depth;
+	int depth;
+	for (depth = helper->first_depth; depth <= max_depth && !out_of_time(data->stats); depth++) {
+		int alpha = MIN_FITNESS;
+		int beta = MAX_FITNESS;
+		data->ply_depth = depth;
+		data->alpha = &alpha;
+		data->beta = &beta;
+		evaluate_moves(data);
+		sort_moves(data->moves, data->fitness, data->state, data->lines, data->color);
+	}
+	__atomic_sub_fetch(helper->root_task.pending, 1, __ATOMIC_RELEASE);
+}
+
+static void prepare_root_task(RootTask *task, Worker *worker) {
+	worker->board = *task->root;
+	task->data.board = &worker->board;
+	task->data.stats = &worker->stats;
+	task->data.heuristics = &worker->heuristics;
+}
+
+static void wait_for_tasks(int *pending) {
+	Worker *self = Pool_self();
+	Task *task;
+	while ((task = Pool_pop(self)) != NULL) {
+		task->run(task, self);
+	}
+	while (__atomic_load_n(pending, __ATOMIC_ACQUIRE) > 0) {
+		sched_yield();
+	}
+}
+#endif
+
 /**
  * Root level of the search.
  * Engine_turn calls this function on a list of moves (by proxy of get_best_move,
@@ -244,8 +748,13 @@ static Move *get_best_move(Board *board, Stats *stats, int color, int ply_depth,
 void *evaluate_moves(void *threadarg) {
 	ThreadData *data = (ThreadData *) threadarg;
 	bool white = (data->color == WHITE);
-	int i;
-	unsigned int killers[MAX_PLY_DEPTH + MAX_EXTRA_PLY_DEPTH] = { 0 };
+	int i, j;
+	Heuristics *heuristics = data->heuristics;
+	// The best evaluations of the chunk so far, best first. With multi-PV
+	// the bound is the worst of them: a move only has to beat that to become
+	// one of the best moves, and then it gets an exact evaluation.
+	int top[MAX_MOVES];
+	int top_count = 0;
 
 	#ifdef PRINT_THINKING
 		int best_fitness = white ? MIN_FITNESS : MAX_FITNESS;
@@ -255,86 +764,139 @@ void *evaluate_moves(void *threadarg) {
 		printf("Evaluating chunk from %d to %d of these moves:\n", data->from, data->to);
 	#endif
 
-	int alpha = MIN_FITNESS;
-	int beta = MAX_FITNESS;
 	// Try each move in the chunk
 	for (i = data->from; i < data->to; i++) {
-		Move *move = data->head[i];
+		// Pick up the bounds as improved by all threads
+		int alpha = __atomic_load_n(data->alpha, __ATOMIC_RELAXED);
+		int beta = __atomic_load_n(data->beta, __ATOMIC_RELAXED);
+		Move move;
+		Move_decode(data->moves->moves[i], &move);
 		// Perform the move
-		UndoableMove *umove = Board_do_move(data->board, move);
+		UndoableMove umove;
+		Board_make_move(data->board, &move, &umove);
 
 		#ifdef PRINT_ALL_MOVES
 			printf("\n");
-			Move_print_color(move, data->color);
+			Move_print_color(&move, data->color);
 			printf(" -> %s(α%s: %d, %sβ%s: %d%s)%s", red, resetcolor, alpha, red, resetcolor, beta, red, resetcolor);
 		#endif
 
-		// Recurse!
-		int * ab = alpha_beta(
-				data->board,
-				data->stats,
-				1,
-				data->ply_depth-1,
-				0, 0,
-				alpha, beta,
-				-data->color,
-				killers);
-		move->fitness = ab[0];
-		if (ab[1] == WHITE_WINS || ab[1] == BLACK_WINS) {
-			move->gives_check_mate = true;
-		} else if (ab[1] == STALE_MATE) {
-			move->gives_draw = true;
+		// Recurse! Like in search_late_move, all but the first move of
+		// the chunk are searched with a null window first.
+		heuristics->played[0] = data->moves->moves[i];
+		Outcome ab = { 0, UNFINISHED };
+		bool done = false;
+		if (i > data->from && beta - alpha > 1) {
+			ab = alpha_beta(
+					data->board,
+					data->stats,
+					1,
+					data->ply_depth-1,
+					0,
+					white ? alpha : beta - 1,
+					white ? alpha + 1 : beta,
+					-data->color,
+					heuristics);
+			done = (white ? ab.fitness <= alpha : ab.fitness >= beta);
+		}
+		if (!done && !out_of_time(data->stats)) {
+			ab = alpha_beta(
+					data->board,
+					data->stats,
+					1,
+					data->ply_depth-1,
+					0,
+					alpha, beta,
+					-data->color,
+					heuristics);
+		}
+		if (out_of_time(data->stats)) {
+			Board_undo_move(data->board, &umove);
+			break;
+		}
+		move.fitness = ab.fitness;
+		// A move that doesn't beat the bound is only known to be at most as
+		// good as the move that set it, maybe in another thread. Make sure
+		// it isn't picked over that move, which has exactly that value.
+		if (white && move.fitness <= alpha && alpha > MIN_FITNESS) {
+			move.fitness = alpha - 1;
+		} else if (!white && move.fitness >= beta && beta < MAX_FITNESS) {
+			move.fitness = beta + 1;
+		}
+		data->fitness[i] = move.fitness;
+		data->state[i] = ab.state;
+		// The move, followed by the line found at the position it leads to
+		Variation *line = &data->lines[i];
+		line->fitness = move.fitness;
+		line->moves[0] = data->moves->moves[i];
+		line->length = heuristics->pv_length[1];
+		for (j = 1; j < line->length; j++) {
+			line->moves[j] = heuristics->pv[1][j];
 		}
 
 		#ifdef PRINT_MOVES
 			printf("[%d-%d:%d] ", data->from, data->to, i);
-			Move_print_color(move, data->color);
-			printf(", evaluation: %d", move->fitness);
+			Move_print_color(&move, data->color);
+			printf(", evaluation: %d", move.fitness);
 			printf("\n");
 		#endif
 
 		#ifdef PRINT_ALL_MOVES
 			printf("\n");
-			Move_print_color(move, data->color);
-			printf(" %s<- %d%s", white ? color_white : color_black, move->fitness, resetcolor);
+			Move_print_color(&move, data->color);
+			printf(" %s<- %d%s", white ? color_white : color_black, move.fitness, resetcolor);
 		#endif
 
 		#ifdef PRINT_THINKING
 			// if (white) {
-			// 	printf("Is fitness %d > %d for ", move->fitness, best_fitness);
+			// 	printf("Is fitness %d > %d for ", move.fitness, best_fitness);
 			// } else {
-			// 	printf("Is fitness %d < %d for ", move->fitness, best_fitness);
+			// 	printf("Is fitness %d < %d for ", move.fitness, best_fitness);
 			// }
 			// Move_print(move);
 			// printf("\n");
-			if ((white && move->fitness > best_fitness) || (!white && move->fitness < best_fitness)) {
+			if ((white && move.fitness > best_fitness) || (!white && move.fitness < best_fitness)) {
 				printf("  Considering ");
-				Move_print_color(move, data->color);
-				printf(", evaluation: %d beats %d\n", move->fitness, best_fitness);
-				best_fitness = move->fitness;
+				Move_print_color(&move, data->color);
+				printf(", evaluation: %d beats %d\n", move.fitness, best_fitness);
+				best_fitness = move.fitness;
 			}
 		#else
-			if (draw_progress) {
+			if (draw_progress && !data->helper) {
 				printf(".");
 				fflush(stdout);
 			}
 		#endif
 
 		// Restore the board
-		Board_undo_move(data->board, umove);
-		Undo_destroy(umove);
+		Board_undo_move(data->board, &umove);
+
+		// Insert the evaluation into the best ones
+		if (top_count < data->multi_pv
+				|| (white ? move.fitness > top[top_count - 1] : move.fitness < top[top_count - 1])) {
+			j = min(top_count, data->multi_pv - 1);
+			for (; j > 0 && (white ? move.fitness > top[j - 1] : move.fitness < top[j - 1]); j--) {
+				top[j] = top[j - 1];
+			}
+			top[j] = move.fitness;
+			top_count = min(top_count + 1, data->multi_pv);
+		}
+		if (top_count < data->multi_pv) {
+			continue;
+		}
 
 		// Check for alpha/beta cut-offs
+		int bound = top[top_count - 1];
 		if (white) {
-			if (move->fitness > alpha) {
-				alpha = move->fitness;
+			if (bound > alpha) {
+				alpha = raise_bound(data->alpha, bound);
 				#ifdef PRINT_ALL_MOVES
 					printf(" %s(α%s = %d%s)%s", red, resetcolor, alpha, red, resetcolor);
 				#endif
 			}
 		} else {
-			if (move->fitness < beta) {
-				beta = move->fitness;
+			if (bound < beta) {
+				beta = lower_bound(data->beta, bound);
 				#ifdef PRINT_ALL_MOVES
 					printf(" %s(β%s = %d%s)%s", red, resetcolor, beta, red, resetcolor);
 				#endif
@@ -344,90 +906,198 @@ void *evaluate_moves(void *threadarg) {
 	return NULL;
 }
 
-static int * alpha_beta(Board *board, Stats *stats, int dist, int depth, int extra_depth, int quiescence_score, int alpha, int beta, int color, unsigned int killers[]) {
-	static int result[2];
+static Outcome alpha_beta(Board *board, Stats *stats, int dist, int depth, int extra_depth, int alpha, int beta, int color, Heuristics *heuristics) {
+	Outcome result;
+	assert(dist <= HEURISTICS_MAX_DIST);
+	Heuristics_pv_clear(heuristics, dist);
+	// Stop when at maximum search depth
+	if (depth + extra_depth <= 0) {
+		result = quiescence(board, stats, 0, alpha, beta, color);
+		#ifdef PRINT_ALL_MOVES
+			printf(" %s%d%s", WHITE ? color_white : color_black, result.fitness, resetcolor);
+		#endif
+		return result;
+	}
+
 	stats->moves_count++;
+	if (out_of_time(stats)) {
+		result.fitness = 0;
+		result.state = UNFINISHED;
+		return result;
+	}
 
-	// Check if we've won/lost.
+	// Maybe this position was searched before, through another order of moves
+	int draft = depth + extra_depth;
+	int alpha_start = alpha;
+	int beta_start = beta;
+	Transposition known;
+	bool is_known = Transposition_probe(board->hash, &known);
+	if (is_known && known.depth >= draft) {
+		if (known.bound == BOUND_EXACT
+				|| (known.bound == BOUND_LOWER && known.score >= beta)
+				|| (known.bound == BOUND_UPPER && known.score <= alpha)) {
+			result.fitness = max(alpha, min(beta, known.score));
+			result.state = UNFINISHED;
+			return result;
+		}
+	}
+
+	// The best move found earlier in this position goes first, then
+	// good captures, the killer moves and countermove, and the other quiet
+	// moves by their history. The moves are only generated
+	// when they are needed, most nodes don't get past the first few.
 	bool at_check = v_king_at_check(board, color);
-	Move *moves = Move_alloc();
-	v_get_all_valid_moves_for_color(&moves, board, color);
-	if (moves == NULL || Move_is_nullmove(moves)) {
-		Move_destroy(moves);
-		if (at_check) {
-			// Mate!
-			if (color == WHITE) {
-				result[0] = MAX_FITNESS;
-				result[1] = WHITE_WINS;
-			} else {
-				result[0] = MIN_FITNESS;
-				result[1] = BLACK_WINS;
+
+	// Near the leaves, a quick estimate of the evaluation often shows that
+	// the node is far outside the window. Not at check, where the material
+	// tells little, and only in null window nodes, so the principal variation
+	// is searched in full.
+	bool frontier = !at_check && draft <= FUTILITY_MAX_DEPTH && dist > 0 && beta - alpha == 1
+			&& alpha > MIN_FITNESS && beta < MAX_FITNESS;
+	int estimate = board->material;
+	if (frontier) {
+		// Reverse futility pruning (static null move): even with the margin
+		// given away, the side to move is past the bound. Like the null move,
+		// this relies on there being a move that keeps that advantage.
+		int margin = REVERSE_FUTILITY_MARGIN * draft;
+		if (has_pieces(board, color)
+				&& (color == WHITE ? estimate - margin >= beta : estimate + margin <= alpha)) {
+			result.fitness = (color == WHITE ? beta : alpha);
+			result.state = UNFINISHED;
+			return result;
+		}
+		// Razoring: so far from the bound that only captures could help.
+		// If the quiescence search doesn't reach the bound either, give up.
+		margin = RAZOR_MARGIN * draft;
+		if (color == WHITE ? estimate + margin <= alpha : estimate - margin >= beta) {
+			Outcome q = quiescence(board, stats, 0, alpha, beta, color);
+			if (out_of_time(stats) || (color == WHITE ? q.fitness <= alpha : q.fitness >= beta)) {
+				return q;
 			}
-		} else {
-			// Stalemate!
-			result[0] = 0;
-			result[1] = STALE_MATE;
 		}
-		return result;
 	}
+	// Futility pruning: quiet moves can't make up the distance to the bound
+	bool futile = frontier && (color == WHITE
+			? estimate + FUTILITY_MARGIN * draft <= alpha
+			: estimate - FUTILITY_MARGIN * draft >= beta);
 
-	// Stop when at maximum search depth
-	if (depth + extra_depth <= MIN_PLY_DEPTH_REMAINDER) {
-		// No need to go beyond MIN_PLY_DEPTH if move is 'quiet':
-		bool allow_pruning = (quiescence_score < QUIESCENCE_THRESHOLD);
-		if (allow_pruning || depth + extra_depth <= 0) {
-			stats->boards_evaluated++;
-			result[0] = Board_evaluate(board);
-			result[1] = 0;
-			#ifdef PRINT_ALL_MOVES
-				printf(" %s%d%s", WHITE ? color_white : color_black, result[0], resetcolor);
-			#endif
-			Move_destroy(moves);
+	// Null move: pass, and let the opponent move twice in a row, with a less
+	// deep search. If even that doesn't get the opponent past the bound,
+	// any real move would do at least as well, and the node is cut off.
+	if (!at_check && draft >= NULL_MOVE_MIN_DEPTH && has_pieces(board, color)
+			// Never twice in a row
+			&& dist > 0 && heuristics->played[dist - 1] != 0
+			&& alpha > MIN_FITNESS && beta < MAX_FITNESS) {
+		UndoableMove umove;
+		Board_make_null_move(board, &umove);
+		heuristics->played[dist] = 0;
+		Outcome null = alpha_beta(board, stats, dist + 1, depth - 1 - NULL_MOVE_REDUCTION, extra_depth,
+				color == WHITE ? beta - 1 : alpha,
+				color == WHITE ? beta : alpha + 1,
+				-color, heuristics);
+		Board_undo_null_move(board, &umove);
+		if (out_of_time(stats)) {
+			return null;
+		}
+		if (color == WHITE ? null.fitness >= beta : null.fitness <= alpha) {
+			result.fitness = (color == WHITE ? beta : alpha);
+			result.state = UNFINISHED;
+			Transposition_store(board->hash, result.fitness, draft,
+					color == WHITE ? BOUND_LOWER : BOUND_UPPER, is_known ? known.move : 0);
 			return result;
 		}
 	}
 
-	// Sort the killer move to the front
-	Heuristics_reorder(killers, dist, &moves);
+	MovePicker picker;
+	Picker_init(&picker, board, color, at_check, is_known ? known.move : 0, heuristics, dist);
+	uint32_t best_move = 0;
 
-	// Important not to count too old events:
-	quiescence_score /= 2;
-	Move *move = moves;
-	while (move) {
+	uint32_t code;
+	int searched = 0;
+	while ((code = Picker_next(&picker)) != 0) {
+		// The first move is always searched, which also tells it's not mate
+		if (futile && searched > 0 && !(code & MOVE_GIVES_CHECK) && !v_is_capture(board, code)) {
+			continue;
+		}
+		#ifdef THREADS
+		// Once the first move is done, other threads may help with the rest,
+		// but there is little work left in a futile node
+		MoveList rest;
+		rest.count = 0;
+		if (searched > 0 && !futile && should_split(draft)) {
+			MoveList_add(&rest, code);
+			Picker_remaining(&picker, &rest);
+		}
+		// If only this move was left, it's searched right here
+		if (rest.count >= 2) {
+			SplitPoint sp;
+			sp.board = *board;
+			sp.moves = &rest;
+			sp.dist = dist;
+			sp.depth = depth;
+			sp.extra_depth = extra_depth;
+			sp.at_check = at_check;
+			sp.color = color;
+			sp.searched = searched;
+			sp.next = 0;
+			sp.alpha = alpha;
+			sp.beta = beta;
+			sp.best_move = best_move;
+			sp.pv_length = heuristics->pv_length[dist];
+			int i;
+			for (i = dist; i < sp.pv_length; i++) {
+				sp.pv[i] = heuristics->pv[dist][i];
+			}
+			sp.cutoff = false;
+			split(&sp, board, stats, heuristics);
+			if (out_of_time(stats)) {
+				result.fitness = 0;
+				result.state = UNFINISHED;
+				return result;
+			}
+			alpha = sp.alpha;
+			beta = sp.beta;
+			best_move = sp.best_move;
+			heuristics->pv_length[dist] = sp.pv_length;
+			for (i = dist; i < sp.pv_length; i++) {
+				heuristics->pv[dist][i] = sp.pv[i];
+			}
+			if (sp.cutoff) {
+				Heuristics_produced_cutoff(heuristics, board, color, dist, draft, best_move);
+				if (color == WHITE) {
+					Transposition_store(board->hash, beta, draft, BOUND_LOWER, best_move);
+					result.fitness = beta;
+				} else {
+					Transposition_store(board->hash, alpha, draft, BOUND_UPPER, best_move);
+					result.fitness = alpha;
+				}
+				result.state = UNFINISHED;
+				return result;
+			}
+			break;
+		}
+		#endif
+		searched++;
+		Move move;
+		Move_decode(code, &move);
 		#ifdef PRINT_ALL_MOVES
 			print_depth(depth);
-			Move_print_color(move, color);
+			Move_print_color(&move, color);
 			printf(": ");
 		#endif
 
-		UndoableMove *umove = Board_do_move(board, move);
-		int score = Move_quiescence(umove, board);
-
 		// Recurse!
-		int * ab = alpha_beta(
-				board,
-				stats,
-				dist + 1,
-				depth - 1,
-				at_check && extra_depth < MAX_EXTRA_PLY_DEPTH ? extra_depth + 1 : extra_depth,
-				quiescence_score + score,
-				alpha,
-				beta,
-				-color,
-				killers);
-		move->fitness = ab[0];
-		if (ab[1] == WHITE_WINS || ab[1] == BLACK_WINS) {
-			move->gives_check_mate = true;
-		} else if (ab[1] == STALE_MATE) {
-			move->gives_draw = true;
-		}
-		Board_undo_move(board, umove);
-		Undo_destroy(umove);
+		Outcome ab = search_late_move(board, stats, dist, depth, extra_depth, at_check, alpha, beta, color, heuristics, code, searched - 1);
+		move.fitness = ab.fitness;
+		if (out_of_time(stats)) {
+			// Don't store anything, the result is not to be trusted
+			return ab;
+		}
 		#ifdef PRINT_ALL_MOVES
 			if (depth > 1) {
 				print_depth(depth);
-				Move_print_color(move, color);
-				printf(" %s<- %d%s", color==WHITE ? color_white : color_black, move->fitness, resetcolor);
+				Move_print_color(&move, color);
+				printf(" %s<- %d%s", color==WHITE ? color_white : color_black, move.fitness, resetcolor);
 			}
 		#endif
 
@@ -436,96 +1106,437 @@ static int * alpha_beta(Board *board, Stats *stats, int dist, int depth, int ext
 		// of a branch is already higher than the maximum of another
 		if (color == WHITE) {
 			#ifndef DISABLE_ALPHA_BETA
-			if (move->fitness >= beta) {
-				Heuristics_produced_cutoff(killers, dist, move);
+			if (move.fitness >= beta) {
+				Heuristics_produced_cutoff(heuristics, board, color, dist, draft, code);
 				#ifdef PRINT_ALL_MOVES
-					printf(" %s(%s%d >= %sβ%s: %d%s)%s", red, resetcolor, move->fitness, red, resetcolor, beta, red, resetcolor);
+					printf(" %s(%s%d >= %sβ%s: %d%s)%s", red, resetcolor, move.fitness, red, resetcolor, beta, red, resetcolor);
 					printf(" returning %sβ%s", red, resetcolor);
 				#endif
-				result[0] = beta;
-				result[1] = UNFINISHED;
-				Move_destroy(moves);
+				Transposition_store(board->hash, beta, draft, BOUND_LOWER, code);
+				result.fitness = beta;
+				result.state = UNFINISHED;
 				return result;
 			}
 			#endif
-			if (move->fitness > alpha) {
-				alpha = move->fitness;
+			if (move.fitness > alpha) {
+				alpha = move.fitness;
+				best_move = code;
+				Heuristics_pv_update(heuristics, dist, code);
 				#ifdef PRINT_ALL_MOVES
 					printf(" %s(α%s = %d%s)%s", red, resetcolor, alpha, red, resetcolor);
 				#endif
 			}
 		} else {
 			#ifndef DISABLE_ALPHA_BETA
-			if (move->fitness <= alpha) {
-				Heuristics_produced_cutoff(killers, dist, move);
+			if (move.fitness <= alpha) {
+				Heuristics_produced_cutoff(heuristics, board, color, dist, draft, code);
 				#ifdef PRINT_ALL_MOVES
-					printf(" %s(%s%d <= %sα%s: %d%s)%s", red, resetcolor, move->fitness, red, resetcolor, alpha, red, resetcolor);
+					printf(" %s(%s%d <= %sα%s: %d%s)%s", red, resetcolor, move.fitness, red, resetcolor, alpha, red, resetcolor);
 					printf(" returning %sα%s", red, resetcolor);
 				#endif
-				result[0] = alpha;
-				result[1] = UNFINISHED;
-				Move_destroy(moves);
+				Transposition_store(board->hash, alpha, draft, BOUND_UPPER, code);
+				result.fitness = alpha;
+				result.state = UNFINISHED;
 				return result;
 			}
 			#endif
-			if (move->fitness < beta) {
-				beta = move->fitness;
+			if (move.fitness < beta) {
+				beta = move.fitness;
+				best_move = code;
+				Heuristics_pv_update(heuristics, dist, code);
 				#ifdef PRINT_ALL_MOVES
 				printf(" %s(β%s = %d%s)%s", red, resetcolor, beta, red, resetcolor);
 				#endif
 			}
 		}
-		move = move->next_sibling;
 	}
 
-	Move_destroy(moves);
+	// Check if we've won/lost.
+	if (searched == 0) {
+		if (at_check) {
+			// Mate! The side to move has lost.
+			if (color == WHITE) {
+				result.fitness = MIN_FITNESS;
+				result.state = BLACK_WINS;
+			} else {
+				result.fitness = MAX_FITNESS;
+				result.state = WHITE_WINS;
+			}
+		} else {
+			// Stalemate!
+			result.fitness = 0;
+			result.state = STALE_MATE;
+		}
+		return result;
+	}
+
 	if (color == WHITE) {
 		#ifdef PRINT_ALL_MOVES
 			printf(" returning %sα%s: %d", red, resetcolor, alpha);
 		#endif
-		result[0] = alpha;
+		result.fitness = alpha;
 	} else {
 		#ifdef PRINT_ALL_MOVES
 			printf(" returning %sβ%s: %d", red, resetcolor, beta);
 		#endif
-		result[0] = beta;
+		result.fitness = beta;
 	}
-	result[1] = UNFINISHED;
+	result.state = UNFINISHED;
+	// The result is only exact if it lies within the original window:
+	int bound = BOUND_EXACT;
+	if (result.fitness <= alpha_start) {
+		bound = BOUND_UPPER;
+	} else if (result.fitness >= beta_start) {
+		bound = BOUND_LOWER;
+	}
+	Transposition_store(board->hash, result.fitness, draft, bound, best_move);
 	return result;
 }
 
-static void create_shuffled_array(Move **arr, Move *head, int total) {
-	Move *curr = head;
-	int i;
-	// Put all pointers in array:
-	for (i = 0; i < total; i++) {
-		arr[i] = curr;
-		if (curr->next_sibling) {
-			curr = curr->next_sibling;
-		} else if (i+1 < total) {
-			fprintf(stderr, "List of moves ends at %d while length should be %d", i+1, total);
-			break;
+static Outcome quiescence(Board *board, Stats *stats, int qdist, int alpha, int beta, int color) {
+	Outcome result;
+	result.state = UNFINISHED;
+	stats->moves_count++;
+	if (out_of_time(stats)) {
+		result.fitness = 0;
+		return result;
+	}
+
+	// The same captures are often tried in another order. The results are
+	// stored with depth 0, so alpha_beta never takes them for its own.
+	int alpha_start = alpha;
+	int beta_start = beta;
+	Transposition known;
+	if (Transposition_probe(board->hash, &known)) {
+		if (known.bound == BOUND_EXACT
+				|| (known.bound == BOUND_LOWER && known.score >= beta)
+				|| (known.bound == BOUND_UPPER && known.score <= alpha)) {
+			result.fitness = max(alpha, min(beta, known.score));
+			return result;
+		}
+	}
+
+	bool at_check = v_king_at_check(board, color) && qdist < MAX_QUIESCENCE_PLY_DEPTH;
+	int stand_pat = 0;
+	if (!at_check) {
+		stats->boards_evaluated++;
+		stand_pat = Board_evaluate(board);
+		// Not capturing is an option too, so the evaluation is a lower bound
+		// for white (and an upper bound for black) of the value of the position.
+		if (color == WHITE) {
+			if (stand_pat >= beta || qdist >= MAX_QUIESCENCE_PLY_DEPTH) {
+				result.fitness = max(alpha, min(beta, stand_pat));
+				return result;
+			}
+			alpha = max(alpha, stand_pat);
+		} else {
+			if (stand_pat <= alpha || qdist >= MAX_QUIESCENCE_PLY_DEPTH) {
+				result.fitness = max(alpha, min(beta, stand_pat));
+				return result;
+			}
+			beta = min(beta, stand_pat);
 		}
 	}
 
+	// When at check every move has to be considered to get out of it,
+	// otherwise only the captures that don't lose material
+	MovePicker picker;
+	Picker_init_quiescence(&picker, board, color, at_check);
+	uint32_t code;
+	int searched = 0;
+	while ((code = Picker_next(&picker)) != 0) {
+		searched++;
+		// Delta pruning: skip captures that can't reach the bound, even with a margin
+		if (!at_check) {
+			int gain = Fitness_capture_gain(board, code) + DELTA_MARGIN;
+			if (color == WHITE ? stand_pat + gain <= alpha : stand_pat - gain >= beta) {
+				continue;
+			}
+		}
+		Move move;
+		Move_decode(code, &move);
+		UndoableMove umove;
+		Board_make_move(board, &move, &umove);
+		Outcome q = quiescence(board, stats, qdist + 1, alpha, beta, -color);
+		Board_undo_move(board, &umove);
+		if (out_of_time(stats)) {
+			return q;
+		}
+		if (color == WHITE) {
+			if (q.fitness >= beta) {
+				result.fitness = beta;
+				Transposition_store(board->hash, beta, 0, BOUND_LOWER, code);
+				return result;
+			}
+			alpha = max(alpha, q.fitness);
+		} else {
+			if (q.fitness <= alpha) {
+				result.fitness = alpha;
+				Transposition_store(board->hash, alpha, 0, BOUND_UPPER, code);
+				return result;
+			}
+			beta = min(beta, q.fitness);
+		}
+	}
+	if (at_check && searched == 0) {
+		// Mate! The side to move has lost.
+		if (color == WHITE) {
+			result.fitness = MIN_FITNESS;
+			result.state = BLACK_WINS;
+		} else {
+			result.fitness = MAX_FITNESS;
+			result.state = WHITE_WINS;
+		}
+		return result;
+	}
+	result.fitness = (color == WHITE ? alpha : beta);
+	int bound = BOUND_EXACT;
+	if (result.fitness <= alpha_start) {
+		bound = BOUND_UPPER;
+	} else if (result.fitness >= beta_start) {
+		bound = BOUND_LOWER;
+	}
+	Transposition_store(board->hash, result.fitness, 0, bound, 0);
+	return result;
+}
+
+static void shuffle_moves(MoveList *moves) {
 	#ifndef DEBUG_KEEP_MOVES_SORTED
-		// Shuffle array by randomly swapping elements
-		for (i = 0; i < total; i++) {
+		int i;
+		// Shuffle by randomly swapping elements
+		for (i = 0; i < moves->count; i++) {
 			// Swap move at i with move at a random position
-			int target = rand() % total;
+			int target = rand() % moves->count;
 			if (target != i) {
-				Move *temp = arr[i];
-				arr[i] = arr[target];
-				arr[target] = temp;
+				uint32_t temp = moves->moves[i];
+				moves->moves[i] = moves->moves[target];
+				moves->moves[target] = temp;
 			}
 		}
+	#endif
+}
+
+static void sort_moves(MoveList *moves, int *fitness, int *state, Variation *lines, int color) {
+	int i, j;
+	// Insertion sort, the list is short and mostly sorted already
+	for (i = 1; i < moves->count; i++) {
+		uint32_t move = moves->moves[i];
+		int f = fitness[i];
+		int s = state[i];
+		Variation line = lines[i];
+		for (j = i; j > 0 && (color == WHITE ? f > fitness[j - 1] : f < fitness[j - 1]); j--) {
+			moves->moves[j] = moves->moves[j - 1];
+			fitness[j] = fitness[j - 1];
+			state[j] = state[j - 1];
+			lines[j] = lines[j - 1];
+		}
+		moves->moves[j] = move;
+		fitness[j] = f;
+		state[j] = s;
+		lines[j] = line;
+	}
+}
+
+static double wall_time() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static bool out_of_time(Stats *stats) {
+	if (stats->moves_count % TIME_CHECK_INTERVAL == 0) {
+		double limit;
+		__atomic_load(&deadline, &limit, __ATOMIC_RELAXED);
+		if (limit > 0 && wall_time() >= limit) {
+			__atomic_store_n(&stop_search, true, __ATOMIC_RELAXED);
+		}
+	}
+	return __atomic_load_n(&stop_search, __ATOMIC_RELAXED);
+}
+
+static Outcome search_move(Board *board, Stats *stats, int dist, int depth, int extra_depth, bool at_check, int alpha, int beta, int color, Heuristics *heuristics, uint32_t code) {
+	heuristics->played[dist] = code;
+	Move move;
+	Move_decode(code, &move);
+	UndoableMove umove;
+	Board_make_move(board, &move, &umove);
+	Outcome ab = alpha_beta(
+			board,
+			stats,
+			dist + 1,
+			depth - 1,
+			at_check && extra_depth < MAX_EXTRA_PLY_DEPTH ? extra_depth + 1 : extra_depth,
+			alpha,
+			beta,
+			-color,
+			heuristics);
+	Board_undo_move(board, &umove);
+	return ab;
+}
+
+static Outcome search_late_move(Board *board, Stats *stats, int dist, int depth, int extra_depth, bool at_check, int alpha, int beta, int color, Heuristics *heuristics, uint32_t code, int index) {
+	// The null window just above alpha for white, just below beta for black
+	int null_alpha = (color == WHITE ? alpha : beta - 1);
+	int null_beta = (color == WHITE ? alpha + 1 : beta);
+	Outcome ab;
+	if (index >= LMR_MIN_MOVES && depth + extra_depth >= LMR_MIN_DEPTH && !at_check
+			&& !(code & MOVE_GIVES_CHECK)
+			&& !v_is_capture(board, code)
+			&& !Heuristics_is_killer(heuristics, dist, code)) {
+		int reduction = (index >= LMR_MANY_MOVES ? 2 : 1);
+		ab = search_move(board, stats, dist, depth - reduction, extra_depth, at_check,
+				null_alpha, null_beta, color, heuristics, code);
+		// Not better than the bound, as expected
+		if (out_of_time(stats) || (color == WHITE ? ab.fitness <= alpha : ab.fitness >= beta)) {
+			return ab;
+		}
+	}
+	if (index > 0 && beta - alpha > 1) {
+		ab = search_move(board, stats, dist, depth, extra_depth, at_check,
+				null_alpha, null_beta, color, heuristics, code);
+		if (out_of_time(stats) || (color == WHITE ? ab.fitness <= alpha : ab.fitness >= beta)) {
+			return ab;
+		}
+	}
+	return search_move(board, stats, dist, depth, extra_depth, at_check, alpha, beta, color, heuristics, code);
+}
+
+static bool has_pieces(Board *board, int color) {
+	int c = COLOR_INDEX(color);
+	return (board->occupied[c] & ~(board->pieces[c][PAWN] | board->pieces[c][KING])) != 0;
+}
+
+#ifdef THREADS
+static bool should_split(int draft) {
+	return parallel_mode == PARALLEL_YBWC
+		&& draft >= SPLIT_MIN_DEPTH
+		&& thread_count > 1
+		&& Pool_self() != NULL;
+}
 
-		// Restore the ->next_sibling pointers to the new order
-		if (total > 1) {
-			for (i = 0; i < total - 1; i++) {
-				arr[i]->next_sibling = arr[i+1];
+static void split(SplitPoint *sp, Board *board, Stats *stats, Heuristics *heuristics) {
+	Worker *self = Pool_self();
+	sp->task.run = help_split_point;
+	pthread_mutex_init(&sp->lock, NULL);
+	// One reference for this thread, one for the deque entry
+	sp->references = 2;
+	Pool_push(self, &sp->task);
+	search_split_point(sp, board, stats, heuristics);
+	// Take the split point back out of the deque, if nobody stole it.
+	// Anything pushed after it has been taken out by now, and older
+	// entries are stolen before it, so it can only be at the bottom.
+	Task *task = Pool_pop(self);
+	assert(task == NULL || task == &sp->task);
+	pthread_mutex_lock(&sp->lock);
+	sp->references -= (task == NULL ? 1 : 2);
+	pthread_mutex_unlock(&sp->lock);
+	// Wait for the helpers to finish
+	while (true) {
+		pthread_mutex_lock(&sp->lock);
+		int references = sp->references;
+		pthread_mutex_unlock(&sp->lock);
+		if (references == 0) {
+			break;
+		}
+		sched_yield();
+	}
+	pthread_mutex_destroy(&sp->lock);
+}
+
+static void search_split_point(SplitPoint *sp, Board *board, Stats *stats, Heuristics *heuristics) {
+	while (true) {
+		pthread_mutex_lock(&sp->lock);
+		if (sp->cutoff || sp->next >= sp->moves->count) {
+			pthread_mutex_unlock(&sp->lock);
+			return;
+		}
+		int i = sp->next++;
+		int alpha = sp->alpha;
+		int beta = sp->beta;
+		pthread_mutex_unlock(&sp->lock);
+
+		uint32_t code = sp->moves->moves[i];
+		Outcome ab = search_late_move(board, stats, sp->dist, sp->depth, sp->extra_depth,
+				sp->at_check, alpha, beta, sp->color, heuristics, code, sp->searched + i);
+		if (out_of_time(stats)) {
+			return;
+		}
+		// Same as in alpha_beta, but with the bounds as they are now
+		pthread_mutex_lock(&sp->lock);
+		if (sp->color == WHITE) {
+			if (ab.fitness >= sp->beta) {
+				sp->cutoff = true;
+				sp->best_move = code;
+			} else if (ab.fitness > sp->alpha) {
+				sp->alpha = ab.fitness;
+				sp->best_move = code;
+				update_split_point_pv(sp, heuristics, code);
+			}
+		} else {
+			if (ab.fitness <= sp->alpha) {
+				sp->cutoff = true;
+				sp->best_move = code;
+			} else if (ab.fitness < sp->beta) {
+				sp->beta = ab.fitness;
+				sp->best_move = code;
+				update_split_point_pv(sp, heuristics, code);
 			}
-			arr[total-1]->next_sibling = NULL;
 		}
-	#endif
+		pthread_mutex_unlock(&sp->lock);
+	}
+}
+
+static void update_split_point_pv(SplitPoint *sp, Heuristics *heuristics, uint32_t code) {
+	Heuristics_pv_update(heuristics, sp->dist, code);
+	sp->pv_length = heuristics->pv_length[sp->dist];
+	int i;
+	for (i = sp->dist; i < sp->pv_length; i++) {
+		sp->pv[i] = heuristics->pv[sp->dist][i];
+	}
+}
+
+static void help_split_point(Task *task, Worker *worker) {
+	SplitPoint *sp = (SplitPoint *) task;
+	// The reference of the deque entry is now this thread's
+	pthread_mutex_lock(&sp->lock);
+	bool has_work = !sp->cutoff && sp->next < sp->moves->count;
+	bool more_work = has_work && sp->next + 1 < sp->moves->count;
+	if (more_work) {
+		sp->references++;
+	}
+	pthread_mutex_unlock(&sp->lock);
+	if (more_work) {
+		// Let yet another thread join in
+		Pool_push(worker, task);
+	}
+	if (has_work) {
+		worker->board = sp->board;
+		search_split_point(sp, &worker->board, &worker->stats, &worker->heuristics);
+	}
+	// The owner may return as soon as this is 0, so don't touch sp after this
+	pthread_mutex_lock(&sp->lock);
+	sp->references--;
+	pthread_mutex_unlock(&sp->lock);
+}
+#endif
+
+static int raise_bound(int *bound, int value) {
+	int current = __atomic_load_n(bound, __ATOMIC_RELAXED);
+	while (value > current) {
+		// On failure current is updated to the bound set by another thread
+		if (__atomic_compare_exchange_n(bound, &current, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			return value;
+		}
+	}
+	return current;
+}
+
+static int lower_bound(int *bound, int value) {
+	int current = __atomic_load_n(bound, __ATOMIC_RELAXED);
+	while (value < current) {
+		if (__atomic_compare_exchange_n(bound, &current, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			return value;
+		}
+	}
+	return current;
 }
@@ -1,4 +1,6 @@
+#include <stdint.h>
 #include "board.h"
+#include "common.h"
 #include "stats.h"
 
 /**
@@ -13,6 +15,21 @@
 #ifndef _ENGINE_H_
 #define _ENGINE_H_
 
+/// Longest line of moves the search can look ahead
+#define MAX_VARIATION_LENGTH (MAX_PLY_DEPTH + MAX_EXTRA_PLY_DEPTH + 1)
+
+/**
+ * A line of moves, starting at the position that was searched,
+ * with the evaluation the search expects at the end of it.
+ */
+typedef struct Variation {
+	/// Evaluation of the line, see Move.fitness
+	int fitness;
+	/// Number of moves in the line
+	int length;
+	/// The moves in their compact form, see MOVE_CODE in move.h
+	uint32_t moves[MAX_VARIATION_LENGTH];
+} Variation;
 
 /**
  * Thinks of the best move for the AI's turn (given color).
@@ -20,8 +37,60 @@
  * (if enabled) uses dynamic ply depth to think extra hard about
  * the best few moves.
  *
+ * The ply depth is at most MAX_PLY_DEPTH (see common.h), a deeper
+ * search is cut back to that.
+ *
+ * Unless `pv` is NULL, the principal variation is copied to it: the move
+ * that is returned, followed by the replies the search expects from both
+ * players. The line may be shorter than the search depth, e.g. where the
+ * search used an earlier result from the transposition table. It is empty
+ * if there were no moves.
+ *
  * Returns the 'best' move for the given color.
  */
-Move *Engine_turn(Board *board, Stats *stats, int color, int ply_depth, int verbosity);
+Move *Engine_turn(Board *board, Stats *stats, int color, int ply_depth, int verbosity, Variation *pv);
+
+/**
+ * Sets the number of moves of which Engine_turn finds the exact evaluation and
+ * principal variation (multi-PV), for analysis. Otherwise only the best move
+ * gets an exact evaluation, the others are just known to be worse. The moves
+ * are found by the same search, with a root bound set by the worst of the best
+ * moves found so far instead of by the best move. Defaults to 1.
+ */
+void Engine_set_multi_pv(int count);
+
+/**
+ * Copies the principal variations of the best moves found by the last call of
+ * Engine_turn to `out`, best first, each with its exact evaluation. Returns the
+ * number of lines, which is the count set by Engine_set_multi_pv, or less
+ * if there were fewer moves or `max` is smaller.
+ */
+int Engine_variations(Variation *out, int max);
+
+/**
+ * Limits the time Engine_turn may take, in seconds. The search is deepened
+ * one ply at a time. No new iteration is started after `soft` seconds,
+ * and a running iteration is aborted after `hard` seconds, in which case
+ * the best move of the last finished iteration is returned.
+ * The first iteration is never aborted. Use 0 for no limit.
+ * Defaults to SOFT_TIME_LIMIT and HARD_TIME_LIMIT (see common.h).
+ */
+void Engine_set_time_limit(double soft, double hard);
+
+/// The root moves are divided over the threads
+#define PARALLEL_ROOT_SPLIT (0)
+/// Every thread searches all moves, sharing only the transposition table
+#define PARALLEL_LAZY_SMP (1)
+/// Young Brothers Wait Concept: the moves of deep nodes are divided over
+/// the threads, after the first move of the node has been searched
+#define PARALLEL_YBWC (2)
+
+/**
+ * Sets the number of threads Engine_turn searches with, and how they
+ * work together: PARALLEL_ROOT_SPLIT, PARALLEL_LAZY_SMP or PARALLEL_YBWC.
+ * Defaults to DEFAULT_THREADS (see common.h) and PARALLEL_ROOT_SPLIT.
+ * Has no effect if the engine is compiled without THREADS.
+ */
+void Engine_set_threads(int threads, int mode);
 
 #endif
\ No newline at end of file
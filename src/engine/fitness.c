@@ -6,6 +6,7 @@
 #include "color.h"
 #include "common.h"
 #include "datatypes.h"
+#include "bitboard.h"
 #include "board.h"
 #include "piece.h"
 #include "validator.h"
@@ -26,6 +27,12 @@ const static int QUEEN_KING_DIST_PER_TILE = -1;		// Manhattan distance between Q
 
 // Material values of the pieces
 const static int MATERIAL_VALUE[5] = {100,520,330,330,980};
+// The same, by piece code, for white and black
+const int FITNESS_PIECE_VALUE[13] = {0, 100,520,330,330,980,0, -100,-520,-330,-330,-980,0};
+// Value of the King when ordering captures. It is never actually traded.
+const static int KING_VALUE = 10000;
+// The shapes from the least to the most valuable
+const static int SHAPE_BY_VALUE[6] = {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING};
 // Penalties for isolated pawns
 const static int ISO_PENALTY[8] = {-12,-14,-16,-20,-20,-16,-14,-12};
 // Knights get rewarded when close to the center,
@@ -57,13 +64,98 @@ char *Fitness_square(int i, int j) {
 	str[2] = '\0';
 	return str;
 } 
-void Fitness_debug(int i, int j, Piece *piece, char *message, int value, int total) {
+void Fitness_debug(int i, int j, int color, char *message, int value, int total) {
 	char *tile = Fitness_square(i, j);
-	char *piece_color = piece->color == WHITE ? cyan : red;
+	char *piece_color = color == WHITE ? cyan : red;
 	printf("%s%s %s%s:\t%s%d \t= %s%d%s\n", piece_color, tile, color_black, message, color_white, value, cyan, total, resetcolor);
 }
 #endif
 
+int Fitness_material(Board *board) {
+	int result = 0;
+	int i, j;
+	for (i = 0; i < 8; i++) {
+		for (j = 0; j < 8; j++) {
+			result += FITNESS_PIECE_VALUE[board->fields[i][j]];
+		}
+	}
+	return result;
+}
+
+int Fitness_material_value(int shape) {
+	return shape == KING ? KING_VALUE : MATERIAL_VALUE[shape];
+}
+
+int Fitness_capture_gain(Board *board, uint32_t code) {
+	int to = MOVE_TO(code);
+	int gain = 0;
+	if (board->occupancy & (1ULL << to)) {
+		gain = Fitness_material_value(Board_get_piece(board, SQUARE_X(to), SQUARE_Y(to))->shape);
+	} else if (!MOVE_PROMOTION(code)) {
+		// En passant, the victim isn't on the target square
+		gain = Fitness_material_value(PAWN);
+	}
+	if (MOVE_PROMOTION(code)) {
+		gain += Fitness_material_value(MOVE_PROMOTION(code)) - Fitness_material_value(PAWN);
+	}
+	return gain;
+}
+
+int Fitness_see(Board *board, uint32_t code) {
+	// gain[d] is what the side making the d-th capture wins,
+	// if the exchange were to stop right after it
+	int gain[32];
+	int d = 0;
+	int from = MOVE_FROM(code);
+	int to = MOVE_TO(code);
+	const Piece *piece = Board_get_piece(board, SQUARE_X(from), SQUARE_Y(from));
+	int color = piece->color;
+	// Value of the piece standing on the target square
+	int on_square = Fitness_material_value(MOVE_PROMOTION(code) ? MOVE_PROMOTION(code) : piece->shape);
+	gain[0] = Fitness_capture_gain(board, code);
+
+	Bitboard occupancy = board->occupancy & ~(1ULL << from);
+	if (piece->shape == PAWN && SQUARE_X(from) != SQUARE_X(to) && !(board->occupancy & (1ULL << to))) {
+		// En passant, the captured pawn is next to the piece
+		occupancy &= ~(1ULL << SQUARE(SQUARE_X(to), SQUARE_Y(from)));
+	}
+	int side = -color;
+	while (d < 31) {
+		Bitboard attackers = v_attackers_to(board, to, occupancy) & occupancy;
+		Bitboard own = attackers & board->occupied[COLOR_INDEX(side)];
+		if (!own) {
+			break;
+		}
+		// Recapture with the least valuable piece
+		int i, shape = KING;
+		Bitboard candidates = 0;
+		for (i = 0; i < 6 && !candidates; i++) {
+			shape = SHAPE_BY_VALUE[i];
+			candidates = own & board->pieces[COLOR_INDEX(side)][shape];
+		}
+		if (shape == KING && (attackers & board->occupied[COLOR_INDEX(-side)])) {
+			// The King can't capture a defended piece
+			break;
+		}
+		d++;
+		gain[d] = on_square - gain[d - 1];
+		if (max(-gain[d - 1], gain[d]) < 0) {
+			// Capturing can't make up for the loss, this side stops here
+			d--;
+			break;
+		}
+		on_square = Fitness_material_value(shape);
+		occupancy &= ~(candidates & -candidates);
+		side = -side;
+	}
+	// Each side may stop capturing when that is better
+	while (d > 0) {
+		gain[d - 1] = -max(-gain[d - 1], gain[d]);
+		d--;
+	}
+	return gain[0];
+}
+
 int Fitness_calculate(Board *board) {
 	// Cache of the number of pawns for each player in each file
 	int cache_pawn_count[2][8];
@@ -75,37 +167,21 @@ int Fitness_calculate(Board *board) {
 	memset(kings_pos, 0, sizeof(kings_pos[0][0]) * 2 * 2);
 	memset(head_count, 0, sizeof(head_count));
 
-	int i, j;
-	// Collect in which columns and rows are pawns,
+	int c, i, j, sq, shape, color;
+	Bitboard bits;
+	// Collect in which columns are pawns,
 	// and where the king is. Also, headcount.
-	Piece *piece;
-	for (i = 0; i < 8; i++) {
-		for (j = 0; j < 8; j++) {
-			piece = Board_get_piece(board, i, j);
-			if (piece == NULL) {
-				continue;
-			}
-			if (piece->shape == PAWN) {
-				if (piece->color == BLACK) {
-					cache_pawn_count[0][i]++;
-				} else {
-					cache_pawn_count[1][i]++;
-				}
-			} else if (piece->shape == KING) {
-				if (piece->color == BLACK) {
-					kings_pos[0][0] = i;
-					kings_pos[0][1] = j;
-				} else {
-					kings_pos[1][0] = i;
-					kings_pos[1][1] = j;
-				}
-			}
-			if (piece->color == BLACK) {
-				head_count[0]++;
-			} else {
-				head_count[1]++;
-			}
+	for (c = 0; c < 2; c++) {
+		bits = board->pieces[c][PAWN];
+		while (bits) {
+			cache_pawn_count[c][SQUARE_X(Bitboard_pop(&bits))]++;
+		}
+		if (board->pieces[c][KING]) {
+			sq = Bitboard_last(board->pieces[c][KING]);
+			kings_pos[c][0] = SQUARE_X(sq);
+			kings_pos[c][1] = SQUARE_Y(sq);
 		}
+		head_count[c] = Bitboard_count(board->occupied[c]);
 	}
 
 	assert (head_count[0] <= 16 && head_count[1] <= 16);
@@ -114,204 +190,207 @@ int Fitness_calculate(Board *board) {
 	// Determine if we're in middle game or end game:
 	// TODO: enhance!
 	//bool endGame = ((head_count[0] + head_count[1]) <= 9)
-	for (i = 0; i < 8; i++) {
-		for (j = 0; j < 8; j++) {
-			piece = Board_get_piece(board, i, j);
-			if (piece == NULL) {
-				continue;
-			}
-			if (piece->shape == PAWN) {
-				result += piece->color * MATERIAL_VALUE[PAWN];
-				#ifdef PRINT_EVAL
-				Fitness_debug(i, j, piece, "pawn\t\t", piece->color * MATERIAL_VALUE[PAWN], result);
-				#endif
-				// Check for isolated (= badly defended) pawns
-				if (get_pawn_count_in_file(cache_pawn_count, i-1, piece->color) == 0 && get_pawn_count_in_file(cache_pawn_count, i+1, piece->color) == 0) {
-					result += piece->color * ISO_PENALTY[i];
+	for (c = 0; c < 2; c++) {
+		color = (c == COLOR_INDEX(WHITE) ? WHITE : BLACK);
+		for (shape = PAWN; shape <= KING; shape++) {
+			bits = board->pieces[c][shape];
+			while (bits) {
+				sq = Bitboard_pop(&bits);
+				i = SQUARE_X(sq);
+				j = SQUARE_Y(sq);
+				if (shape == PAWN) {
+					result += color * MATERIAL_VALUE[PAWN];
 					#ifdef PRINT_EVAL
-					Fitness_debug(i, j, piece, "  bad defense", piece->color * ISO_PENALTY[i], result);
+					Fitness_debug(i, j, color, "pawn\t\t", color * MATERIAL_VALUE[PAWN], result);
 					#endif
-				}
-				// Check for doubled pawns (= obstruction and bad defense)
-				if (get_pawn_count_in_file(cache_pawn_count, i, piece->color) > 1) {
-					result += piece->color * DOUBLE_PAWN_PENALTY;
-					#ifdef PRINT_EVAL
-					Fitness_debug(i, j, piece, "  doubled\t", piece->color * DOUBLE_PAWN_PENALTY, result);
-					#endif
-				}
-				// Check for e and d pawns being blocked by self or opponent
-				if (i == 3 || i == 4) {
-					int one_ahead = max(0, min(7, j - piece->color));
-					if (Board_is_empty(board, i, one_ahead)) {
+					// Check for isolated (= badly defended) pawns
+					if (get_pawn_count_in_file(cache_pawn_count, i-1, color) == 0 && get_pawn_count_in_file(cache_pawn_count, i+1, color) == 0) {
+						result += color * ISO_PENALTY[i];
 						#ifdef PRINT_EVAL
-						Fitness_debug(i, j, piece, "  E/D, can progress", 0, result);
+						Fitness_debug(i, j, color, "  bad defense", color * ISO_PENALTY[i], result);
 						#endif
-					} else if (Board_is_color(board, i, one_ahead, piece->color)) {
-						result += piece->color * E_AND_D_PENALTY;
-						#ifdef PRINT_EVAL
-						Fitness_debug(i, j, piece, "  E/D blocked by self", piece->color * E_AND_D_PENALTY, result);
-						#endif
-					} else {
-						result += piece->color * E_AND_D_BLOCKEDPENALTY;
+					}
+					// Check for doubled pawns (= obstruction and bad defense)
+					if (get_pawn_count_in_file(cache_pawn_count, i, color) > 1) {
+						result += color * DOUBLE_PAWN_PENALTY;
 						#ifdef PRINT_EVAL
-						Fitness_debug(i, j, piece, "  E/D blocked by enemy", piece->color * E_AND_D_BLOCKEDPENALTY, result);
+						Fitness_debug(i, j, color, "  doubled\t", color * DOUBLE_PAWN_PENALTY, result);
 						#endif
 					}
-				}
-				// Reward pawns near king (within 2 tiles distance)
-				if (piece->color == BLACK) {
-					if (abs(i - kings_pos[0][0]) + abs(j - kings_pos[0][1]) <= 2) {
-						result += piece->color * PAWN_NEAR_KING_BONUS;
+					// Check for e and d pawns being blocked by self or opponent
+					if (i == 3 || i == 4) {
+						int one_ahead = max(0, min(7, j - color));
+						if (Board_is_empty(board, i, one_ahead)) {
+							#ifdef PRINT_EVAL
+							Fitness_debug(i, j, color, "  E/D, can progress", 0, result);
+							#endif
+						} else if (Board_is_color(board, i, one_ahead, color)) {
+							result += color * E_AND_D_PENALTY;
+							#ifdef PRINT_EVAL
+							Fitness_debug(i, j, color, "  E/D blocked by self", color * E_AND_D_PENALTY, result);
+							#endif
+						} else {
+							result += color * E_AND_D_BLOCKEDPENALTY;
+							#ifdef PRINT_EVAL
+							Fitness_debug(i, j, color, "  E/D blocked by enemy", color * E_AND_D_BLOCKEDPENALTY, result);
+							#endif
+						}
+					}
+					// Reward pawns near king (within 2 tiles distance)
+					if (color == BLACK) {
+						if (abs(i - kings_pos[0][0]) + abs(j - kings_pos[0][1]) <= 2) {
+							result += color * PAWN_NEAR_KING_BONUS;
+							#ifdef PRINT_EVAL
+							Fitness_debug(i, j, color, "  near king\t", color * PAWN_NEAR_KING_BONUS, result);
+							#endif
+						}
+					} else if (abs(i - kings_pos[1][0]) + abs(j - kings_pos[1][1]) <= 2) {
+						result += color * PAWN_NEAR_KING_BONUS;
 						#ifdef PRINT_EVAL
-						Fitness_debug(i, j, piece, "  near king\t", piece->color * PAWN_NEAR_KING_BONUS, result);
+						Fitness_debug(i, j, color, "  near king\t", color * PAWN_NEAR_KING_BONUS, result);
 						#endif
 					}
-				} else if (abs(i - kings_pos[1][0]) + abs(j - kings_pos[1][1]) <= 2) {
-					result += piece->color * PAWN_NEAR_KING_BONUS;
+				} else if (shape == KNIGHT) {
+					result += color * MATERIAL_VALUE[KNIGHT];
 					#ifdef PRINT_EVAL
-					Fitness_debug(i, j, piece, "  near king\t", piece->color * PAWN_NEAR_KING_BONUS, result);
+					Fitness_debug(i, j, color, "knight\t", color * MATERIAL_VALUE[KNIGHT], result);
 					#endif
-				}
-			} else if (piece->shape == KNIGHT) {
-				result += piece->color * MATERIAL_VALUE[KNIGHT];
-				#ifdef PRINT_EVAL
-				Fitness_debug(i, j, piece, "knight\t", piece->color * MATERIAL_VALUE[KNIGHT], result);
-				#endif
-				// Reward short distance to center
-				int distance = distance_to_center(i, j);
-				result += piece->color * KNIGHT_CENTER_BONUS[distance];
-				#ifdef PRINT_EVAL
-				Fitness_debug(i, j, piece, "  near center", piece->color * KNIGHT_CENTER_BONUS[distance], result);
-				#endif
-				// Fine distance to either king
-				distance = abs(kings_pos[0][0] - i) + abs(kings_pos[0][1] - j)
-						 + abs(kings_pos[1][0] - i) + abs(kings_pos[1][1] - j);
-				result += piece->color * KNIGHT_KING_DIST_PER_TILE * distance;
-				#ifdef PRINT_EVAL
-				Fitness_debug(i, j, piece, "  distance to kings", piece->color * KNIGHT_KING_DIST_PER_TILE * distance, result);
-				#endif
-			} else if (piece->shape == BISHOP) {
-				result += piece->color * MATERIAL_VALUE[BISHOP];
-				#ifdef PRINT_EVAL
-				Fitness_debug(i, j, piece, "bishop\t", piece->color * MATERIAL_VALUE[BISHOP], result);
-				#endif
-				// Reward Bishop when mobility is high
-				int mobility = v_get_rough_move_count_for_piece(board, i, j);
-				int bonus = 0;
-				if (mobility >= 12) {
-					bonus = BISHOP_MOB_BONUS[4];
-				} else if (mobility >= 9) {
-					bonus = BISHOP_MOB_BONUS[3];
-				} else if (mobility >= 6) {
-					bonus = BISHOP_MOB_BONUS[2];
-				} else if (mobility >= 3) {
-					bonus = BISHOP_MOB_BONUS[1];
-				} else {
-					bonus = BISHOP_MOB_BONUS[0];
-				}
-				result += piece->color * bonus;
-				#ifdef PRINT_EVAL
-				Fitness_debug(i, j, piece, "  mobility\t", piece->color * bonus, result);
-				#endif
-			} else if (piece->shape == ROOK) {
-				result += piece->color * MATERIAL_VALUE[ROOK];
-				#ifdef PRINT_EVAL
-				Fitness_debug(i, j, piece, "rook\t\t", piece->color * MATERIAL_VALUE[ROOK], result);
-				#endif
-				// Reward Rook when mobility is high
-				int mobility = v_get_rough_move_count_for_piece(board, i, j);
-				int bonus = 0;
-				if (mobility >= 12) {
-					bonus = ROOK_MOB_BONUS[4];
-				} else if (mobility >= 9) {
-					bonus = ROOK_MOB_BONUS[3];
-				} else if (mobility >= 6) {
-					bonus = ROOK_MOB_BONUS[2];
-				} else if (mobility >= 3) {
-					bonus = ROOK_MOB_BONUS[1];
-				} else {
-					bonus = ROOK_MOB_BONUS[0];
-				}
-				result += piece->color * bonus;
-				#ifdef PRINT_EVAL
-				Fitness_debug(i, j, piece, "  mobility\t", piece->color * bonus, result);
-				#endif
-				// reward rook when no pawns are on the same file
-				if (get_pawn_count_in_file(cache_pawn_count, i,piece->color) == 0) {
-					result += piece->color * ROOK_NO_FRIENDLY_PAWNS_BONUS;
+					// Reward short distance to center
+					int distance = distance_to_center(i, j);
+					result += color * KNIGHT_CENTER_BONUS[distance];
 					#ifdef PRINT_EVAL
-					Fitness_debug(i, j, piece, "  no friendly pawns", piece->color * ROOK_NO_FRIENDLY_PAWNS_BONUS, result);
+					Fitness_debug(i, j, color, "  near center", color * KNIGHT_CENTER_BONUS[distance], result);
 					#endif
-				}
-				if (get_pawn_count_in_file(cache_pawn_count, i,-piece->color) == 0) {
-					result += piece->color * ROOK_NO_ENEMY_PAWNS_BONUS;
+					// Fine distance to either king
+					distance = abs(kings_pos[0][0] - i) + abs(kings_pos[0][1] - j)
+							 + abs(kings_pos[1][0] - i) + abs(kings_pos[1][1] - j);
+					result += color * KNIGHT_KING_DIST_PER_TILE * distance;
 					#ifdef PRINT_EVAL
-					Fitness_debug(i, j, piece, "  no enemy pawns", piece->color * ROOK_NO_ENEMY_PAWNS_BONUS, result);
+					Fitness_debug(i, j, color, "  distance to kings", color * KNIGHT_KING_DIST_PER_TILE * distance, result);
 					#endif
-				}
-			} else if (piece->shape == QUEEN) {
-				result += piece->color * MATERIAL_VALUE[QUEEN];
+				} else if (shape == BISHOP) {
+					result += color * MATERIAL_VALUE[BISHOP];
 					#ifdef PRINT_EVAL
-					Fitness_debug(i, j, piece, "queen\t", piece->color * MATERIAL_VALUE[QUEEN], result);
+					Fitness_debug(i, j, color, "bishop\t", color * MATERIAL_VALUE[BISHOP], result);
 					#endif
-				// Fine for distance to own King
-				if (piece->color == BLACK) {
-					result += piece->color
-							* QUEEN_KING_DIST_PER_TILE
-							* (abs(kings_pos[0][0] - i) + abs(kings_pos[0][1] - j));
+					// Reward Bishop when mobility is high
+					int mobility = Bitboard_count(Bitboard_bishop_attacks(sq, board->occupancy) & ~board->occupied[c]);
+					int bonus = 0;
+					if (mobility >= 12) {
+						bonus = BISHOP_MOB_BONUS[4];
+					} else if (mobility >= 9) {
+						bonus = BISHOP_MOB_BONUS[3];
+					} else if (mobility >= 6) {
+						bonus = BISHOP_MOB_BONUS[2];
+					} else if (mobility >= 3) {
+						bonus = BISHOP_MOB_BONUS[1];
+					} else {
+						bonus = BISHOP_MOB_BONUS[0];
+					}
+					result += color * bonus;
 					#ifdef PRINT_EVAL
-					Fitness_debug(i, j, piece, "  distance to king", piece->color * QUEEN_KING_DIST_PER_TILE * (abs(kings_pos[0][0] - i) + abs(kings_pos[0][1] - j)), result);
+					Fitness_debug(i, j, color, "  mobility\t", color * bonus, result);
 					#endif
-				} else {
-					result += piece->color
-							* QUEEN_KING_DIST_PER_TILE
-							* (abs(kings_pos[1][0] - i) + abs(kings_pos[1][1] - j));
+				} else if (shape == ROOK) {
+					result += color * MATERIAL_VALUE[ROOK];
 					#ifdef PRINT_EVAL
-					Fitness_debug(i, j, piece, "  distance to king", piece->color * QUEEN_KING_DIST_PER_TILE * (abs(kings_pos[1][0] - i) + abs(kings_pos[1][1] - j)), result);
+					Fitness_debug(i, j, color, "rook\t\t", color * MATERIAL_VALUE[ROOK], result);
 					#endif
-				}
-			} else if (piece->shape == KING) {
-				// Fine/reward king according to distance to center and game state.
-				// King near center gets -24 penalty when game is opening and +36 when game is ending.
-				// No bonus when opponent has 1 or more pawns in 3 files around king
-				float distance = (float) distance_to_center(i, j);
-				int progress = (int) max(1, head_count[piece->color == BLACK ? 0 : 1] / 2);
-				int bonus = (int) ((distance / 6.0) * KING_CENTER_BONUS[progress - 1]);
-				// Enemy pawns in the same file as the king
-				int pawns = get_pawn_count_in_file(cache_pawn_count, i, -piece->color);
-				#ifdef PRINT_EVAL
-				Fitness_debug(i, j, piece, "king - game progress (.5x headcount)", progress, 0);
-				Fitness_debug(i, j, piece, "king - center distance", (int) distance, 0);
-				Fitness_debug(i, j, piece, "king - resulting bonus", bonus, 0);
-				Fitness_debug(i, j, piece, "king - pawns near\t", i, 0);
-				#endif
-				if (i > 0) {
-					// Enemy pawns in one file to the left of the king
-					int more_pawns = get_pawn_count_in_file(cache_pawn_count, i-1, -piece->color);
-					pawns = pawns + more_pawns;
+					// Reward Rook when mobility is high
+					int mobility = Bitboard_count(Bitboard_rook_attacks(sq, board->occupancy) & ~board->occupied[c]);
+					int bonus = 0;
+					if (mobility >= 12) {
+						bonus = ROOK_MOB_BONUS[4];
+					} else if (mobility >= 9) {
+						bonus = ROOK_MOB_BONUS[3];
+					} else if (mobility >= 6) {
+						bonus = ROOK_MOB_BONUS[2];
+					} else if (mobility >= 3) {
+						bonus = ROOK_MOB_BONUS[1];
+					} else {
+						bonus = ROOK_MOB_BONUS[0];
+					}
+					result += color * bonus;
 					#ifdef PRINT_EVAL
-					Fitness_debug(i, j, piece, "king - more pawns near", more_pawns, 0);
+					Fitness_debug(i, j, color, "  mobility\t", color * bonus, result);
 					#endif
-				}
-				if (i < 7) {
-					// Enemy pawns in one file to the right of the king
-					int more_pawns = get_pawn_count_in_file(cache_pawn_count, i+1, -piece->color);
-					pawns = pawns + more_pawns;
+					// reward rook when no pawns are on the same file
+					if (get_pawn_count_in_file(cache_pawn_count, i,color) == 0) {
+						result += color * ROOK_NO_FRIENDLY_PAWNS_BONUS;
+						#ifdef PRINT_EVAL
+						Fitness_debug(i, j, color, "  no friendly pawns", color * ROOK_NO_FRIENDLY_PAWNS_BONUS, result);
+						#endif
+					}
+					if (get_pawn_count_in_file(cache_pawn_count, i,-color) == 0) {
+						result += color * ROOK_NO_ENEMY_PAWNS_BONUS;
+						#ifdef PRINT_EVAL
+						Fitness_debug(i, j, color, "  no enemy pawns", color * ROOK_NO_ENEMY_PAWNS_BONUS, result);
+						#endif
+					}
+				} else if (shape == QUEEN) {
+					result += color * MATERIAL_VALUE[QUEEN];
+						#ifdef PRINT_EVAL
+						Fitness_debug(i, j, color, "queen\t", color * MATERIAL_VALUE[QUEEN], result);
+						#endif
+					// Fine for distance to own King
+					if (color == BLACK) {
+						result += color
+								* QUEEN_KING_DIST_PER_TILE
+								* (abs(kings_pos[0][0] - i) + abs(kings_pos[0][1] - j));
+						#ifdef PRINT_EVAL
+						Fitness_debug(i, j, color, "  distance to king", color * QUEEN_KING_DIST_PER_TILE * (abs(kings_pos[0][0] - i) + abs(kings_pos[0][1] - j)), result);
+						#endif
+					} else {
+						result += color
+								* QUEEN_KING_DIST_PER_TILE
+								* (abs(kings_pos[1][0] - i) + abs(kings_pos[1][1] - j));
+						#ifdef PRINT_EVAL
+						Fitness_debug(i, j, color, "  distance to king", color * QUEEN_KING_DIST_PER_TILE * (abs(kings_pos[1][0] - i) + abs(kings_pos[1][1] - j)), result);
+						#endif
+					}
+				} else if (shape == KING) {
+					// Fine/reward king according to distance to center and game state.
+					// King near center gets -24 penalty when game is opening and +36 when game is ending.
+					// No bonus when opponent has 1 or more pawns in 3 files around king
+					float distance = (float) distance_to_center(i, j);
+					int progress = (int) max(1, head_count[color == BLACK ? 0 : 1] / 2);
+					int bonus = (int) ((distance / 6.0) * KING_CENTER_BONUS[progress - 1]);
+					// Enemy pawns in the same file as the king
+					int pawns = get_pawn_count_in_file(cache_pawn_count, i, -color);
 					#ifdef PRINT_EVAL
-					Fitness_debug(i, j, piece, "king - more pawns near", more_pawns, 0);
+					Fitness_debug(i, j, color, "king - game progress (.5x headcount)", progress, 0);
+					Fitness_debug(i, j, color, "king - center distance", (int) distance, 0);
+					Fitness_debug(i, j, color, "king - resulting bonus", bonus, 0);
+					Fitness_debug(i, j, color, "king - pawns near\t", i, 0);
 					#endif
-				}
-				if (pawns > 1 && bonus != 0) {
-					// We still hand out a penalty, but no bonus. Hence the min/max
-					bonus = (piece->color == BLACK ? max(bonus, 0) : min(bonus, 0));
+					if (i > 0) {
+						// Enemy pawns in one file to the left of the king
+						int more_pawns = get_pawn_count_in_file(cache_pawn_count, i-1, -color);
+						pawns = pawns + more_pawns;
+						#ifdef PRINT_EVAL
+						Fitness_debug(i, j, color, "king - more pawns near", more_pawns, 0);
+						#endif
+					}
+					if (i < 7) {
+						// Enemy pawns in one file to the right of the king
+						int more_pawns = get_pawn_count_in_file(cache_pawn_count, i+1, -color);
+						pawns = pawns + more_pawns;
+						#ifdef PRINT_EVAL
+						Fitness_debug(i, j, color, "king - more pawns near", more_pawns, 0);
+						#endif
+					}
+					if (pawns > 1 && bonus != 0) {
+						// We still hand out a penalty, but no bonus. Hence the min/max
+						bonus = (color == BLACK ? max(bonus, 0) : min(bonus, 0));
+						#ifdef PRINT_EVAL
+						Fitness_debug(i, j, color, "  no bonus because enemy pawns are near", bonus, 0);
+						#endif
+					}
+					result += color * bonus;
 					#ifdef PRINT_EVAL
-					Fitness_debug(i, j, piece, "  no bonus because enemy pawns are near", bonus, 0);
+					Fitness_debug(i, j, color, "  result\t", color * bonus, result);
 					#endif
 				}
-				result += piece->color * bonus;
-				#ifdef PRINT_EVAL
-				Fitness_debug(i, j, piece, "  result\t", piece->color * bonus, result);
-				#endif
 			}
 		}
 	}
@@ -319,7 +398,7 @@ int Fitness_calculate(Board *board) {
 		int random = (rand() % RANDOM_FACTOR);
 		result += random;
 		#ifdef PRINT_EVAL
-		Fitness_debug(i, j, piece, "random\t\t", random, result);
+		Fitness_debug(i, j, WHITE, "random\t\t", random, result);
 		#endif
 	#endif
 	return result;
@@ -1,3 +1,4 @@
+#include <stdint.h>
 #include "datatypes.h"
 
 /**
@@ -26,6 +27,39 @@
  */
 int Fitness_calculate(Board *board);
 
+/// Material value of each piece code (see PIECE_CODE in piece.h) as counted by
+/// Fitness_calculate, negative for black pieces. The King counts for nothing.
+extern const int FITNESS_PIECE_VALUE[13];
+
+/**
+ * Returns the material balance: the material value of the white pieces minus
+ * that of the black pieces. Board.material holds the same, kept up to date
+ * by Board_set, so this is only needed to check it.
+ */
+int Fitness_material(Board *board);
+
+/**
+ * Returns the material value of a piece of the given shape, as used by
+ * Fitness_calculate. The King, which can't be traded, gets a large value.
+ */
+int Fitness_material_value(int shape);
+
+/**
+ * Returns the material a capture or promotion wins: the value of the
+ * captured piece, plus what a pawn gains by promoting.
+ */
+int Fitness_capture_gain(Board *board, uint32_t code);
+
+/**
+ * Static exchange evaluation: returns the material the side making the
+ * move wins, when both sides keep recapturing on the target square with
+ * their least valuable piece for as long as that pays off. Pieces that
+ * attack through the pieces that were traded off (x-rays) take part too.
+ * Pins and checks are ignored. Negative if the move loses material.
+ * Works for any move, a quiet move just starts with a gain of 0.
+ */
+int Fitness_see(Board *board, uint32_t code);
+
 inline int max(int a, int b) {
 	return a > b ? a : b;
 }
@@ -1,54 +1,93 @@
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "bitboard.h"
 #include "board.h"
 #include "common.h"
 #include "datatypes.h"
 #include "heuristics.h"
 #include "move.h"
 #include "piece.h"
+#include "validator.h"
 
-const int maxdepth = MAX_PLY_DEPTH + MAX_EXTRA_PLY_DEPTH;
-	
 
-void Heuristics_produced_cutoff(unsigned int killers[], int depth, Move *m) {
-	unsigned int num = Move_get_as_int(m);
-	//printf(" = %d", num);
-	if (killers[depth] != num) {
-		//printf(", new killer move on level %d", depth);
-		killers[depth] = num;
-	}
+void Heuristics_clear(Heuristics *heuristics) {
+	memset(heuristics, 0, sizeof(Heuristics));
 }
 
-void Heuristics_reorder(unsigned int killers[], int depth, Move **head) {
-	Move *curr = *head;
-	Move *prev = NULL;
-	int i = 0;
-	while (curr != NULL) {
-		unsigned int num = Move_get_as_int(curr);
-		if (killers[depth] == num) {
-			if (i == 0) {
-				// Nothing to do
-				return;
+void Heuristics_age(Heuristics *heuristics) {
+	int c, from, to;
+	for (c = 0; c < 2; c++) {
+		for (from = 0; from < 64; from++) {
+			for (to = 0; to < 64; to++) {
+				heuristics->history[c][from][to] /= 2;
 			}
+		}
+	}
+	memset(heuristics->killers, 0, sizeof(heuristics->killers));
+}
 
-			// Move to the front!
-			//printf(", moving ");
-			//Move_print(curr);
-			//printf(" (=%d) to the front from spot %d...", num, i);
+void Heuristics_produced_cutoff(Heuristics *heuristics, Board *board, int color, int dist, int draft, uint32_t move) {
+	if (v_is_capture(board, move)) {
+		return;
+	}
+	// Flags don't matter, only which move it is
+	uint32_t id = MOVE_ID(move);
+	uint32_t *killers = heuristics->killers[dist];
+	if (killers[0] != id) {
+		killers[1] = killers[0];
+		killers[0] = id;
+	}
+	if (dist > 0 && heuristics->played[dist - 1] != 0) {
+		uint32_t previous = heuristics->played[dist - 1];
+		heuristics->countermoves[COLOR_INDEX(color)][MOVE_FROM(previous)][MOVE_TO(previous)] = id;
+	}
+	// The bonus shrinks as the score gets closer to HISTORY_MAX,
+	// so the score never goes past it
+	int *score = &heuristics->history[COLOR_INDEX(color)][MOVE_FROM(move)][MOVE_TO(move)];
+	int bonus = draft * draft;
+	if (bonus > HISTORY_MAX) {
+		bonus = HISTORY_MAX;
+	}
+	*score += bonus - *score * bonus / HISTORY_MAX;
+}
 
-			Move *next = curr->next_sibling;	// backup next in line
-			curr->next_sibling = *head;			// head comes 2nd
-			*head = curr;						// current becomes the new head
-			if (prev != NULL) {					// glue the gap that's left behind
-				prev->next_sibling = next;
-			}
-			return;
+bool Heuristics_is_killer(Heuristics *heuristics, int dist, uint32_t move) {
+	int i;
+	for (i = 0; i < KILLER_SLOTS; i++) {
+		if (heuristics->killers[dist][i] == MOVE_ID(move)) {
+			return true;
 		}
-		// Moving on!
-		prev = curr;
-		curr = curr->next_sibling;
-		i++;
 	}
-	//printf(" no killer moves on level %d", depth);
+	return false;
+}
+
+int Heuristics_history(Heuristics *heuristics, int color, uint32_t move) {
+	return heuristics->history[COLOR_INDEX(color)][MOVE_FROM(move)][MOVE_TO(move)];
+}
+
+uint32_t Heuristics_countermove(Heuristics *heuristics, int color, int dist) {
+	if (dist == 0 || heuristics->played[dist - 1] == 0) {
+		return 0;
+	}
+	uint32_t previous = heuristics->played[dist - 1];
+	return heuristics->countermoves[COLOR_INDEX(color)][MOVE_FROM(previous)][MOVE_TO(previous)];
+}
+
+void Heuristics_pv_clear(Heuristics *heuristics, int dist) {
+	heuristics->pv_length[dist] = dist;
+}
+
+void Heuristics_pv_update(Heuristics *heuristics, int dist, uint32_t move) {
+	uint32_t *line = heuristics->pv[dist];
+	uint32_t *child = heuristics->pv[dist + 1];
+	int length = heuristics->pv_length[dist + 1];
+	int i;
+	line[dist] = move;
+	for (i = dist + 1; i < length; i++) {
+		line[i] = child[i];
+	}
+	heuristics->pv_length[dist] = length;
 }
@@ -1,4 +1,6 @@
 #include <stdbool.h>
+#include <stdint.h>
+#include "common.h"
 #include "datatypes.h"
 
 /**
@@ -6,21 +8,101 @@
  *
  * Functions to determine heuristics, used in Move-Ordering.
  *
+ * Captures are ordered by what they win, but the quiet moves need
+ * something else. A quiet move that caused a cut-off somewhere is likely
+ * to cause one again in a similar position:
+ * - killer moves: the last two quiet moves that caused a cut-off at the
+ *   same distance from the root, i.e. in a sibling position,
+ * - the countermove: the quiet move that refuted the move just made
+ *   by the opponent, last time that move was made,
+ * - the history: a score per player and from and to square, raised every
+ *   time that move causes a cut-off, more so deeper in the tree.
+ *
+ * Along the way they collect the principal variation: the line of best
+ * moves the search expects both players to play. It is kept in a triangular
+ * table, with a row per distance from the root. A node that finds a new best
+ * move copies the row of its child behind that move into its own row.
+ *
+ * Each search thread has its own Heuristics, so they need no locking.
+ * They are kept from turn to turn, and aged at the start of each turn so
+ * the scores of older searches count less.
+ *
  */
 #ifndef _HEURISTICS_H_
 #define _HEURISTICS_H_
 
+/// Number of distances from the root the search can reach
+#define HEURISTICS_MAX_DIST (MAX_PLY_DEPTH + MAX_EXTRA_PLY_DEPTH)
+/// Number of killer moves per distance from the root
+#define KILLER_SLOTS (2)
+/// History scores never go above this value
+#define HISTORY_MAX (1 << 14)
+
+typedef struct Heuristics {
+	/// Killer moves as MOVE_ID, per distance from the root, the newest first
+	uint32_t killers[HEURISTICS_MAX_DIST][KILLER_SLOTS];
+	/// The move made at each distance from the root, in the line being searched
+	uint32_t played[HEURISTICS_MAX_DIST];
+	/// History scores, by [COLOR_INDEX(color)][from][to]
+	int history[2][64][64];
+	/// Countermoves as MOVE_ID, by [COLOR_INDEX(color)][from][to] of the opponent's move
+	uint32_t countermoves[2][64][64];
+	/// Principal variation per distance from the root: the best line found from
+	/// the node at that distance is pv[dist][dist] up to pv[dist][pv_length[dist] - 1].
+	/// One extra row, as the nodes past the last distance start an (empty) line too.
+	uint32_t pv[HEURISTICS_MAX_DIST + 1][HEURISTICS_MAX_DIST + 1];
+	int pv_length[HEURISTICS_MAX_DIST + 1];
+} Heuristics;
+
+/**
+ * Forgets everything.
+ */
+void Heuristics_clear(Heuristics *heuristics);
+
+/**
+ * Prepares for a new search: halves the history scores, and forgets the
+ * killer moves, which were found at other distances from the root.
+ */
+void Heuristics_age(Heuristics *heuristics);
+
 /**
  * Tells the Heuristics calculated that this move
  * has produced a beta-cutoff in the search tree,
  * which is a sign of a positive heuristic.
+ * Only quiet moves are remembered, captures are ordered anyway.
+ * board - the position the move was made in
+ * color - the player that made the move
+ * dist  - distance of the position from the root
+ * draft - remaining depth of the position, a deeper cut-off counts more
+ */
+void Heuristics_produced_cutoff(Heuristics *heuristics, Board *board, int color, int dist, int draft, uint32_t move);
+
+/**
+ * Tells if the move is one of the killer moves at the given distance from the root.
+ */
+bool Heuristics_is_killer(Heuristics *heuristics, int dist, uint32_t move);
+
+/**
+ * Returns the history score of a move of the given player.
+ */
+int Heuristics_history(Heuristics *heuristics, int color, uint32_t move);
+
+/**
+ * Returns the countermove for the move made at the previous distance from
+ * the root, as MOVE_ID, or 0 if there is none. It may not be valid.
+ */
+uint32_t Heuristics_countermove(Heuristics *heuristics, int color, int dist);
+
+/**
+ * Starts an empty principal variation for the node at the given distance from the root.
  */
-void Heuristics_produced_cutoff(unsigned int killers[], int depth, Move *m);
+void Heuristics_pv_clear(Heuristics *heuristics, int dist);
 
 /**
- * Puts the killer move at the front.
- * The killer move is recognized by having a higher heuristic.
+ * Sets the principal variation of the node at the given distance from the root
+ * to the move, followed by the principal variation of the node it leads to,
+ * which must have been searched.
  */
-void Heuristics_reorder(unsigned int killers[], int depth, Move **head);
+void Heuristics_pv_update(Heuristics *heuristics, int dist, uint32_t move);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,132 @@
+#include <assert.h>
+#include <stdint.h>
+#include "common.h"
+#include "datatypes.h"
+#include "bitboard.h"
+#include "magic.h"
+
+// Size of the attack tables of all squares together.
+// These are the sums of 2^(bits in mask) over all 64 squares.
+#define ROOK_TABLE_SIZE (102400)
+#define BISHOP_TABLE_SIZE (5248)
+
+Magic ROOK_MAGICS[64];
+Magic BISHOP_MAGICS[64];
+
+static Bitboard ROOK_TABLE[ROOK_TABLE_SIZE];
+static Bitboard BISHOP_TABLE[BISHOP_TABLE_SIZE];
+
+// Steps in x and y for the four directions of each slider
+const static int ROOK_DX[4] = {1, -1, 0, 0};
+const static int ROOK_DY[4] = {0, 0, 1, -1};
+const static int BISHOP_DX[4] = {1, 1, -1, -1};
+const static int BISHOP_DY[4] = {1, -1, 1, -1};
+
+// Magic numbers for every square. These were found once by trying random
+// sparse numbers until one mapped all blocker subsets of a square without
+// conflicting collisions, and are hardcoded so startup stays fast.
+const static Bitboard ROOK_MAGIC_NUMBERS[64] = {
+	0x0080068051E04000ULL, 0x0040001000402000ULL, 0x0080100020008008ULL, 0x4E000A0010208440ULL,
+	0x4200040802002010ULL, 0x0100010008020400ULL, 0x9080608019000600ULL, 0x8100020080204100ULL,
+	0x4103800480400020ULL, 0x8015004004802100ULL, 0x000200108A002040ULL, 0x0801000821001000ULL,
+	0x0015000500080070ULL, 0x0120800400800200ULL, 0x0109000432001100ULL, 0x020080055B000080ULL,
+	0x0080004000402002ULL, 0x5260848020004008ULL, 0x2402020014402080ULL, 0x3000808010000802ULL,
+	0x0304018004810800ULL, 0x0000808004000200ULL, 0x0002040001500248ULL, 0x0012020000408401ULL,
+	0x8440008080004020ULL, 0x0804200840100040ULL, 0x0820008080201000ULL, 0x2080100100082100ULL,
+	0x0001000500100800ULL, 0x00A1000900028400ULL, 0x0100100400C80102ULL, 0x000001120000A044ULL,
+	0x800080C004800620ULL, 0x4040081000202000ULL, 0x0D08802008801000ULL, 0x1000800800801004ULL,
+	0x1004000801010010ULL, 0x0402800400800200ULL, 0x0004080204008110ULL, 0x0000404082000401ULL,
+	0x00C0118861408000ULL, 0x1100220081020048ULL, 0x09A0430420050010ULL, 0x0000082200420010ULL,
+	0x2110080004008080ULL, 0x2004201040680104ULL, 0x1106001451820008ULL, 0x0002224104820014ULL,
+	0x00800C8044210500ULL, 0x02A0200040100040ULL, 0x040100A0001E4100ULL, 0x00204023108A0200ULL,
+	0x2400080080040080ULL, 0x1289008400020900ULL, 0x0002088250010400ULL, 0x0001006084010200ULL,
+	0x0001023480002141ULL, 0x0006400021810015ULL, 0x8400100840200101ULL, 0x40003000A1000825ULL,
+	0x1002011008200402ULL, 0x100D000400080201ULL, 0x0020048806102904ULL, 0x8401000020804201ULL
+};
+const static Bitboard BISHOP_MAGIC_NUMBERS[64] = {
+	0x4C40240122060016ULL, 0x8048110404004A80ULL, 0x8004440410414020ULL, 0x021C410060405000ULL,
+	0x80CD1040D0480812ULL, 0x0002021104000082ULL, 0x08440082A8200001ULL, 0x00202A0800841002ULL,
+	0x0200C40810842088ULL, 0x60C0081000C08901ULL, 0x00A3D0040042510CULL, 0x1C00110400808541ULL,
+	0x0400820211084005ULL, 0x0000008860080800ULL, 0x002002020202C000ULL, 0x0400344E08040A81ULL,
+	0x812800102098A080ULL, 0x00202010823A2040ULL, 0x4086400800830201ULL, 0x5008012A22004000ULL,
+	0x0004801C00A00000ULL, 0x0000400200505400ULL, 0x0480408401080820ULL, 0x8000400029082824ULL,
+	0x0008880804501000ULL, 0x0001600048084100ULL, 0x0108220624040400ULL, 0x0008080000820002ULL,
+	0xC804040010410041ULL, 0x01080A0040208400ULL, 0x2018030480A88800ULL, 0x4040410020410810ULL,
+	0x1108044010100210ULL, 0x084A100400029800ULL, 0x0801080100820C00ULL, 0x8010400808108200ULL,
+	0x0084008400020500ULL, 0x0002004200290481ULL, 0x0010150200032090ULL, 0x8404042220404102ULL,
+	0x0302080308004008ULL, 0x1200420820000408ULL, 0x0802002024200800ULL, 0x4020824208000084ULL,
+	0x000002020C008200ULL, 0x2C40208081000882ULL, 0x2082223441000401ULL, 0x8804080081101020ULL,
+	0x4401011002220808ULL, 0x81020C4202100000ULL, 0x4005004404040308ULL, 0x0820400C42020001ULL,
+	0x0020206421820010ULL, 0x0150401001424008ULL, 0x02A20242020C0608ULL, 0x5020110109011200ULL,
+	0x2050840108410401ULL, 0x0100090880842108ULL, 0x220008960142187AULL, 0x1111028880208820ULL,
+	0x4400200042028200ULL, 0x4400010802084206ULL, 0x0000400242040100ULL, 0x0002201104010944ULL
+};
+
+/**
+ * Returns the attacks of a slider by walking along its rays.
+ * Slow, only used to fill the tables.
+ */
+static Bitboard sliding_attacks(int sq, Bitboard occupancy, const int dx[4], const int dy[4]);
+
+/**
+ * Fills the Magic structs and attack table of one type of slider.
+ */
+static void init_slider(Magic magics[64], const Bitboard magic_numbers[64], Bitboard *table, const int dx[4], const int dy[4]);
+
+extern inline unsigned int Magic_index(Magic *m, Bitboard occupancy);
+
+void Magic_init() {
+	init_slider(ROOK_MAGICS, ROOK_MAGIC_NUMBERS, ROOK_TABLE, ROOK_DX, ROOK_DY);
+	init_slider(BISHOP_MAGICS, BISHOP_MAGIC_NUMBERS, BISHOP_TABLE, BISHOP_DX, BISHOP_DY);
+}
+
+static Bitboard sliding_attacks(int sq, Bitboard occupancy, const int dx[4], const int dy[4]) {
+	Bitboard attacks = 0;
+	int dir;
+	for (dir = 0; dir < 4; dir++) {
+		int x = SQUARE_X(sq) + dx[dir];
+		int y = SQUARE_Y(sq) + dy[dir];
+		while (x >= 0 && x <= 7 && y >= 0 && y <= 7) {
+			attacks |= SQUARE_BIT(x, y);
+			if (Bitboard_has(occupancy, x, y)) {
+				break;
+			}
+			x += dx[dir];
+			y += dy[dir];
+		}
+	}
+	return attacks;
+}
+
+static void init_slider(Magic magics[64], const Bitboard magic_numbers[64], Bitboard *table, const int dx[4], const int dy[4]) {
+	const Bitboard rank_8 = 0xFFULL;
+	const Bitboard rank_1 = 0xFFULL << 56;
+	Bitboard *next = table;
+	int sq;
+	for (sq = 0; sq < 64; sq++) {
+		Magic *m = &magics[sq];
+		// Pieces on the edge of the board never block anything,
+		// unless the slider itself is on that edge.
+		Bitboard edges = ((rank_8 | rank_1) & ~(rank_8 << (8 * SQUARE_Y(sq))))
+				| ((FILE_A_BITS | FILE_H_BITS) & ~(FILE_A_BITS << SQUARE_X(sq)));
+		m->mask = sliding_attacks(sq, 0, dx, dy) & ~edges;
+		m->magic = magic_numbers[sq];
+		m->shift = 64 - Bitboard_count(m->mask);
+		m->attacks = next;
+		next += 1 << Bitboard_count(m->mask);
+
+		// Enumerate all subsets of the mask (Carry-Rippler trick)
+		// and store the attacks for each of them.
+		Bitboard b = 0;
+		do {
+			Bitboard attacks = sliding_attacks(sq, b, dx, dy);
+			unsigned int index = Magic_index(m, b);
+			#ifndef __BMI2__
+			// Two subsets may only share an index when their attacks are the same
+			assert(m->attacks[index] == 0 || m->attacks[index] == attacks);
+			#endif
+			m->attacks[index] = attacks;
+			b = (b - m->mask) & m->mask;
+		} while (b);
+	}
+}
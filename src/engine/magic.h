@@ -0,0 +1,60 @@
+#include <stdint.h>
+#include "datatypes.h"
+
+/**
+ * magic.h / magic.c
+ *
+ * Precomputed attack tables for the sliding pieces (rooks, bishops and
+ * queens), indexed with 'magic bitboards': the occupied squares that can
+ * block a slider are multiplied by a magic number, and the top bits of the
+ * product are used as an index into a table holding the attacked squares.
+ * When compiled with BMI2 support (e.g. -mbmi2), the PEXT instruction is
+ * used to compute the index instead.
+ *
+ * The magic numbers are hardcoded in magic.c, the tables are filled once
+ * by Magic_init, which Bitboard_init calls. After that a slider attack is
+ * a single table lookup, see Bitboard_rook_attacks in bitboard.h.
+ *
+ */
+#ifndef _MAGIC_H_
+#define _MAGIC_H_
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+/**
+ * Everything needed to look up the attacks of a slider on one square.
+ */
+typedef struct Magic {
+	/// Squares that can block the slider, excluding the edges of the board
+	Bitboard mask;
+	/// Multiplier that maps every subset of mask to a unique index
+	Bitboard magic;
+	/// Start of this square's part of the attack table
+	Bitboard *attacks;
+	/// 64 minus the number of bits in the index
+	int shift;
+} Magic;
+
+/// Filled by Magic_init
+extern Magic ROOK_MAGICS[64];
+extern Magic BISHOP_MAGICS[64];
+
+/**
+ * Fills the attack tables.
+ */
+void Magic_init();
+
+/**
+ * Returns the index into m->attacks for the given occupied squares.
+ */
+inline unsigned int Magic_index(Magic *m, Bitboard occupancy) {
+#ifdef __BMI2__
+	return (unsigned int) _pext_u64(occupancy, m->mask);
+#else
+	return (unsigned int) (((occupancy & m->mask) * m->magic) >> m->shift);
+#endif
+}
+
+#endif
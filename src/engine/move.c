@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "bitboard.h"
 #include "board.h"
 #include "color.h"
 #include "common.h"
@@ -55,15 +56,32 @@ extern inline bool Move_equals(Move *m1, Move *m2);
 
 extern inline int Move_compare(Move *m1, Move *m2);
 
-unsigned int Move_get_as_int(Move *m) {
-	unsigned int r = 0;
-	r |= (((char) m->x) << 24);
-	r |= (((char) m->y) << 16);
-	r |= (((char) m->x) << 8);
-	r |= (char) m->x;
-	return r;
+uint32_t Move_encode(Move *m) {
+	uint32_t code = MOVE_CODE(SQUARE(m->x, m->y), SQUARE(m->xx, m->yy), m->promotion);
+	if (m->gives_check) {
+		code |= MOVE_GIVES_CHECK;
+	}
+	return code;
+}
+
+void Move_decode(uint32_t code, Move *out) {
+	out->x = SQUARE_X(MOVE_FROM(code));
+	out->y = SQUARE_Y(MOVE_FROM(code));
+	out->xx = SQUARE_X(MOVE_TO(code));
+	out->yy = SQUARE_Y(MOVE_TO(code));
+	out->promotion = MOVE_PROMOTION(code);
+	out->is_castling = false;
+	out->is_en_passant = false;
+	out->gives_check = (code & MOVE_GIVES_CHECK) != 0;
+	out->gives_draw = false;
+	out->gives_check_mate = false;
+	out->is_evasion = false;
+	out->fitness = 0;
+	out->next_sibling = NULL;
 }
 
+extern inline void MoveList_add(MoveList *list, uint32_t code);
+
 void Move_print(Move *m) {
 	if (m->promotion == 0) {
 		printf("%c%d-%c%d", m->x + 'a', 8 - m->y, m->xx + 'a', 8 - m->yy);
@@ -95,8 +113,13 @@ void Move_print_all(Move *head) {
 	}
 }
 
-UndoableMove *Undo_create(int x, int y, int xx, int yy, int hit_y, Piece *piece, bool white_can_castle_queens_side, bool white_can_castle_kings_side, bool black_can_castle_queens_side, bool black_can_castle_kings_side, bool white_can_en_passant, bool black_can_en_passant) {
+UndoableMove *Undo_create(int x, int y, int xx, int yy, int hit_y, const Piece *piece, bool white_can_castle_queens_side, bool white_can_castle_kings_side, bool black_can_castle_queens_side, bool black_can_castle_kings_side, uint8_t white_can_en_passant, uint8_t black_can_en_passant) {
 	UndoableMove *umove = malloc(sizeof(UndoableMove));
+	Undo_init(umove, x, y, xx, yy, hit_y, piece, white_can_castle_queens_side, white_can_castle_kings_side, black_can_castle_queens_side, black_can_castle_kings_side, white_can_en_passant, black_can_en_passant);
+	return umove;
+}
+
+void Undo_init(UndoableMove *umove, int x, int y, int xx, int yy, int hit_y, const Piece *piece, bool white_can_castle_queens_side, bool white_can_castle_kings_side, bool black_can_castle_queens_side, bool black_can_castle_kings_side, uint8_t white_can_en_passant, uint8_t black_can_en_passant) {
 	umove->x = x; umove->y = y;
 	umove->xx = xx; umove->yy = yy;
 	umove->hit_y = (hit_y == -1 ? y : hit_y);
@@ -111,7 +134,6 @@ UndoableMove *Undo_create(int x, int y, int xx, int yy, int hit_y, Piece *piece,
 	umove->is_castling = false;
 	umove->adds_to_fifty = false;
 	umove->previous = NULL;
-	return umove;
 }
 
 void Undo_destroy(UndoableMove* umove) {
@@ -120,4 +142,3 @@ void Undo_destroy(UndoableMove* umove) {
 
 extern inline bool Move_is_first(UndoableMove *umove);
 
-extern inline int Move_quiescence(UndoableMove *umove, Board *board);
@@ -11,6 +11,18 @@
 #ifndef _MOVE_H_
 #define _MOVE_H_
 
+/// Compact moves, as stored in a MoveList. The lower 16 bits identify the move:
+/// bits 0-5 are the source square and bits 6-11 the target square (see SQUARE
+/// in bitboard.h), bits 12-14 the shape to promote to, or 0.
+#define MOVE_CODE(from, to, promotion) ((uint32_t) ((from) | ((to) << 6) | ((promotion) << 12)))
+#define MOVE_FROM(code) ((code) & 0x3F)
+#define MOVE_TO(code) (((code) >> 6) & 0x3F)
+#define MOVE_PROMOTION(code) (((code) >> 12) & 0x7)
+/// The part of the code that identifies the move, without the flags below
+#define MOVE_ID(code) ((code) & 0xFFFF)
+/// Flag for moves that put the opponent in check
+#define MOVE_GIVES_CHECK (1 << 16)
+
 /**
  * Creates a blank Move; doesn't initialize memory for it,
  * only allocates.
@@ -49,7 +61,23 @@ inline bool Move_equals(Move *m1, Move *m2) {
 	return m1->x == m2->x && m1->y == m2->y && m1->xx == m2->xx && m1->yy == m2->yy;
 }
 
-unsigned int Move_get_as_int(Move *m);
+/**
+ * Returns the compact form of the move, including the check flag.
+ */
+uint32_t Move_encode(Move *m);
+
+/**
+ * Fills in `out` from the compact form of a move. Flags not stored
+ * in the code are cleared, and the fitness is set to 0.
+ */
+void Move_decode(uint32_t code, Move *out);
+
+/**
+ * Appends a move to the list.
+ */
+inline void MoveList_add(MoveList *list, uint32_t code) {
+	list->moves[list->count++] = code;
+}
 
 /**
  * This is just a simple toString method.
@@ -77,7 +105,13 @@ inline int Move_compare(Move *m1, Move *m2) {
  * Constructor for UndoableMoves, i.e. structs that contain instructions on
  * how to undo a move.
  */
-UndoableMove *Undo_create(int x, int y, int xx, int yy, int hit_y, Piece *piece, bool white_can_castle_queens_side, bool white_can_castle_kings_side, bool black_can_castle_queens_side, bool black_can_castle_kings_side, bool white_can_en_passant, bool black_can_en_passant);
+UndoableMove *Undo_create(int x, int y, int xx, int yy, int hit_y, const Piece *piece, bool white_can_castle_queens_side, bool white_can_castle_kings_side, bool black_can_castle_queens_side, bool black_can_castle_kings_side, uint8_t white_can_en_passant, uint8_t black_can_en_passant);
+
+/**
+ * Like Undo_create, but fills in an existing UndoableMove,
+ * e.g. one on the stack.
+ */
+void Undo_init(UndoableMove *umove, int x, int y, int xx, int yy, int hit_y, const Piece *piece, bool white_can_castle_queens_side, bool white_can_castle_kings_side, bool black_can_castle_queens_side, bool black_can_castle_kings_side, uint8_t white_can_en_passant, uint8_t black_can_en_passant);
 
 /**
  * Cleans up an UndoableMove
@@ -92,9 +126,5 @@ void Undo_destroy(UndoableMove* umove);
 inline bool Move_is_first(UndoableMove *umove) {
 	return umove->previous == NULL;
 }
-	
-inline int Move_quiescence(UndoableMove *umove, Board *board) {
-	return umove->hit_piece == NULL ? 0 : QUIESCENCE_PENALTY_CAPTURE;
-}
 
 #endif
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "bitboard.h"
+#include "board.h"
+#include "common.h"
+#include "datatypes.h"
+#include "fitness.h"
+#include "heuristics.h"
+#include "move.h"
+#include "picker.h"
+#include "validator.h"
+
+/// The stages, in order. The *_INIT stages generate the moves of the next one.
+#define STAGE_HASH_MOVE (0)
+#define STAGE_CAPTURES_INIT (1)
+#define STAGE_GOOD_CAPTURES (2)
+#define STAGE_REFUTATIONS (3)
+#define STAGE_QUIETS_INIT (4)
+#define STAGE_QUIETS (5)
+#define STAGE_BAD_CAPTURES (6)
+#define STAGE_EVASIONS_INIT (7)
+#define STAGE_EVASIONS (8)
+#define STAGE_QUIESCENCE_INIT (9)
+#define STAGE_QUIESCENCE (10)
+#define STAGE_DONE (11)
+
+/**
+ * Scores a capture by MVV-LVA (Most Valuable Victim - Least Valuable
+ * Attacker): the value of what it wins decides, and of two moves that win
+ * the same, the one with the least valuable piece goes first.
+ */
+static int mvv_lva(Board *board, uint32_t code);
+
+/**
+ * Tells if a capture doesn't lose material, according to the static
+ * exchange evaluation. Captures of a piece worth at least as much as
+ * the capturing piece don't need it.
+ */
+static bool is_good_capture(Board *board, uint32_t code);
+
+/**
+ * Returns the move with the highest score of the moves that
+ * are left in the current stage, or 0 if there are none.
+ */
+static uint32_t pick_best(MovePicker *picker);
+
+/**
+ * Tells if the move is one of the refutations, which are
+ * handed out before the other quiet moves.
+ */
+static bool is_refutation(MovePicker *picker, uint32_t code);
+
+/**
+ * Scores a quiet move by its history, 0 without Heuristics.
+ */
+static int quiet_score(MovePicker *picker, uint32_t code);
+
+
+void Picker_init(MovePicker *picker, Board *board, int color, bool at_check, uint32_t hash_move, Heuristics *heuristics, int dist) {
+	picker->board = board;
+	picker->color = color;
+	picker->stage = at_check ? STAGE_EVASIONS_INIT : STAGE_HASH_MOVE;
+	picker->hash_move = MOVE_ID(hash_move);
+	picker->heuristics = heuristics;
+	int i;
+	for (i = 0; i < PICKER_REFUTATIONS; i++) {
+		picker->refutations[i] = 0;
+	}
+	if (heuristics != NULL) {
+		for (i = 0; i < KILLER_SLOTS; i++) {
+			picker->refutations[i] = heuristics->killers[dist][i];
+		}
+		picker->refutations[KILLER_SLOTS] = Heuristics_countermove(heuristics, color, dist);
+	}
+	picker->moves.count = 0;
+	picker->next = 0;
+	picker->bad_captures.count = 0;
+}
+
+void Picker_init_quiescence(MovePicker *picker, Board *board, int color, bool at_check) {
+	Picker_init(picker, board, color, at_check, 0, NULL, 0);
+	if (!at_check) {
+		picker->stage = STAGE_QUIESCENCE_INIT;
+	}
+}
+
+uint32_t Picker_next(MovePicker *picker) {
+	uint32_t code;
+	int i;
+	switch (picker->stage) {
+		case STAGE_HASH_MOVE:
+			picker->stage = STAGE_CAPTURES_INIT;
+			code = v_find_move(picker->board, picker->color, picker->hash_move);
+			if (code != 0) {
+				return code;
+			}
+			// No valid hash move, fall through to the next stage
+		case STAGE_CAPTURES_INIT:
+			v_get_captures(&picker->moves, picker->board, picker->color);
+			for (i = 0; i < picker->moves.count; i++) {
+				picker->scores[i] = mvv_lva(picker->board, picker->moves.moves[i]);
+			}
+			picker->next = 0;
+			picker->stage = STAGE_GOOD_CAPTURES;
+		case STAGE_GOOD_CAPTURES:
+			while ((code = pick_best(picker)) != 0) {
+				if (MOVE_ID(code) == picker->hash_move) {
+					continue;
+				}
+				if (!is_good_capture(picker->board, code)) {
+					MoveList_add(&picker->bad_captures, code);
+					continue;
+				}
+				return code;
+			}
+			picker->next = 0;
+			picker->stage = STAGE_REFUTATIONS;
+		case STAGE_REFUTATIONS:
+			while (picker->next < PICKER_REFUTATIONS) {
+				// Skip moves that were handed out already, captures included
+				uint32_t id = picker->refutations[picker->next];
+				bool seen = (id == 0 || id == picker->hash_move);
+				for (i = 0; i < picker->next; i++) {
+					seen = seen || picker->refutations[i] == id;
+				}
+				picker->next++;
+				if (seen) {
+					continue;
+				}
+				code = v_find_move(picker->board, picker->color, id);
+				if (code != 0 && !v_is_capture(picker->board, code)) {
+					return code;
+				}
+			}
+			picker->stage = STAGE_QUIETS_INIT;
+		case STAGE_QUIETS_INIT:
+			v_get_quiets(&picker->moves, picker->board, picker->color);
+			for (i = 0; i < picker->moves.count; i++) {
+				picker->scores[i] = quiet_score(picker, picker->moves.moves[i]);
+			}
+			picker->next = 0;
+			picker->stage = STAGE_QUIETS;
+		case STAGE_QUIETS:
+			while ((code = pick_best(picker)) != 0) {
+				if (MOVE_ID(code) != picker->hash_move && !is_refutation(picker, code)) {
+					return code;
+				}
+			}
+			picker->next = 0;
+			picker->stage = STAGE_BAD_CAPTURES;
+		case STAGE_BAD_CAPTURES:
+			if (picker->next < picker->bad_captures.count) {
+				return picker->bad_captures.moves[picker->next++];
+			}
+			picker->stage = STAGE_DONE;
+			return 0;
+		case STAGE_EVASIONS_INIT:
+			v_get_evasions(&picker->moves, picker->board, picker->color);
+			for (i = 0; i < picker->moves.count; i++) {
+				code = picker->moves.moves[i];
+				if (MOVE_ID(code) == picker->hash_move) {
+					picker->scores[i] = INT_MAX;
+				} else if (v_is_capture(picker->board, code)) {
+					picker->scores[i] = mvv_lva(picker->board, code);
+				} else {
+					picker->scores[i] = quiet_score(picker, code);
+				}
+			}
+			picker->next = 0;
+			picker->stage = STAGE_EVASIONS;
+		case STAGE_EVASIONS:
+			code = pick_best(picker);
+			if (code == 0) {
+				picker->stage = STAGE_DONE;
+			}
+			return code;
+		case STAGE_QUIESCENCE_INIT:
+			v_get_captures(&picker->moves, picker->board, picker->color);
+			for (i = 0; i < picker->moves.count; i++) {
+				picker->scores[i] = mvv_lva(picker->board, picker->moves.moves[i]);
+			}
+			picker->next = 0;
+			picker->stage = STAGE_QUIESCENCE;
+		case STAGE_QUIESCENCE:
+			// Captures that lose material are left out
+			while ((code = pick_best(picker)) != 0) {
+				if (is_good_capture(picker->board, code)) {
+					return code;
+				}
+			}
+			picker->stage = STAGE_DONE;
+			return 0;
+		default:
+			return 0;
+	}
+}
+
+void Picker_remaining(MovePicker *picker, MoveList *list) {
+	uint32_t code;
+	while ((code = Picker_next(picker)) != 0) {
+		MoveList_add(list, code);
+	}
+}
+
+static int mvv_lva(Board *board, uint32_t code) {
+	int from = MOVE_FROM(code);
+	int attacker = Fitness_material_value(Board_get_piece(board, SQUARE_X(from), SQUARE_Y(from))->shape);
+	return (Fitness_capture_gain(board, code) << 16) - attacker;
+}
+
+static bool is_good_capture(Board *board, uint32_t code) {
+	int from = MOVE_FROM(code);
+	int attacker = Fitness_material_value(Board_get_piece(board, SQUARE_X(from), SQUARE_Y(from))->shape);
+	return Fitness_capture_gain(board, code) >= attacker
+		|| Fitness_see(board, code) >= 0;
+}
+
+static uint32_t pick_best(MovePicker *picker) {
+	if (picker->next >= picker->moves.count) {
+		return 0;
+	}
+	// Selection sort, one move at a time: often only the first is needed
+	int best = picker->next;
+	int i;
+	for (i = best + 1; i < picker->moves.count; i++) {
+		if (picker->scores[i] > picker->scores[best]) {
+			best = i;
+		}
+	}
+	uint32_t code = picker->moves.moves[best];
+	int score = picker->scores[best];
+	picker->moves.moves[best] = picker->moves.moves[picker->next];
+	picker->scores[best] = picker->scores[picker->next];
+	picker->moves.moves[picker->next] = code;
+	picker->scores[picker->next] = score;
+	picker->next++;
+	return code;
+}
+
+static bool is_refutation(MovePicker *picker, uint32_t code) {
+	int i;
+	for (i = 0; i < PICKER_REFUTATIONS; i++) {
+		if (picker->refutations[i] == MOVE_ID(code)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static int quiet_score(MovePicker *picker, uint32_t code) {
+	if (picker->heuristics == NULL) {
+		return 0;
+	}
+	return Heuristics_history(picker->heuristics, picker->color, code);
+}
@@ -0,0 +1,84 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "datatypes.h"
+#include "heuristics.h"
+
+/**
+ * picker.h / picker.c
+ *
+ * The move picker hands out the moves of a position one at a time, in the
+ * order alpha_beta should try them:
+ * 1. the best move found by an earlier search (the hash move),
+ * 2. captures that don't lose material according to the static exchange
+ *    evaluation, the most valuable victim first (MVV-LVA),
+ * 3. the refutations: the two killer moves and the countermove,
+ * 4. the other quiet moves, by their history score,
+ * 5. captures that lose material.
+ *
+ * Each stage is generated only when the previous one is used up. Most
+ * nodes are cut off by one of the first moves, and then the rest of the
+ * moves are never generated at all.
+ *
+ * A player at check has few moves. All of them are generated at
+ * once, with the hash move first and then the captures.
+ *
+ * The quiescence search only gets the captures that don't lose material,
+ * in the same order, or the evasions when at check.
+ *
+ */
+#ifndef _PICKER_H_
+#define _PICKER_H_
+
+/// Number of refutations: the killer moves and the countermove
+#define PICKER_REFUTATIONS (KILLER_SLOTS + 1)
+
+typedef struct MovePicker {
+	/// Position and player the moves are for
+	Board *board;
+	int color;
+	/// Current stage, see picker.c
+	int stage;
+	/// MOVE_ID of the hash move, or 0 if none
+	uint32_t hash_move;
+	/// Move ordering heuristics of the search thread, or NULL
+	Heuristics *heuristics;
+	/// MOVE_ID of the killer moves and the countermove, 0 if none
+	uint32_t refutations[PICKER_REFUTATIONS];
+	/// Moves of the current stage
+	MoveList moves;
+	/// Order of the moves of the current stage, the highest goes first
+	int scores[MAX_MOVES];
+	/// Index of the next move to hand out
+	int next;
+	/// Captures that lose material, kept for the last stage
+	MoveList bad_captures;
+} MovePicker;
+
+/**
+ * Prepares the picker for the given position. Nothing is generated yet.
+ * The killer moves and countermove are taken from the Heuristics, for the
+ * given distance from the root. The hash move and these may be any move,
+ * only valid ones are handed out. `heuristics` may be NULL.
+ */
+void Picker_init(MovePicker *picker, Board *board, int color, bool at_check, uint32_t hash_move, Heuristics *heuristics, int dist);
+
+/**
+ * Prepares the picker for the quiescence search: it only hands out the
+ * captures and promotions that don't lose material, or all evasions
+ * when at check.
+ */
+void Picker_init_quiescence(MovePicker *picker, Board *board, int color, bool at_check);
+
+/**
+ * Returns the next move, or 0 when there are no more moves.
+ * Apart from the quiescence search, every valid move is returned exactly once.
+ */
+uint32_t Picker_next(MovePicker *picker);
+
+/**
+ * Adds all moves that Picker_next would still return to the list,
+ * in the same order. After this, the picker has no more moves.
+ */
+void Picker_remaining(MovePicker *picker, MoveList *list);
+
+#endif
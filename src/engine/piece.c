@@ -1,48 +1,34 @@
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
 #include "color.h"
 #include "datatypes.h"
 #include "piece.h"
 
 
-Piece *Piece_create(int shape, int color) {
-	Piece *p = malloc(sizeof(Piece));
-	p->color = color;
-	p->shape = shape;
-	if (color == WHITE) {
-		switch(shape) {
-			case PAWN:		p->symbol = strdup("wp");	break;
-			case ROOK:		p->symbol = strdup("wR");	break;
-			case KNIGHT:	p->symbol = strdup("wN");	break;
-			case BISHOP:	p->symbol = strdup("wB");	break;
-			case QUEEN:		p->symbol = strdup("wQ");	break;
-			case KING: 		p->symbol = strdup("wK");	break;
-		}
-	} else {
-		switch(shape) {
-			case PAWN:		p->symbol = strdup("bp");	break;
-			case ROOK:		p->symbol = strdup("bR");	break;
-			case KNIGHT:	p->symbol = strdup("bN");	break;
-			case BISHOP:	p->symbol = strdup("bB");	break;
-			case QUEEN:		p->symbol = strdup("bQ");	break;
-			case KING: 		p->symbol = strdup("bK");	break;
-		}
-	}
-	return p;
-}
+const Piece PIECES[13] = {
+	{EMPTY, EMPTY, NULL},
+	{WHITE, PAWN, "wp"},
+	{WHITE, ROOK, "wR"},
+	{WHITE, KNIGHT, "wN"},
+	{WHITE, BISHOP, "wB"},
+	{WHITE, QUEEN, "wQ"},
+	{WHITE, KING, "wK"},
+	{BLACK, PAWN, "bp"},
+	{BLACK, ROOK, "bR"},
+	{BLACK, KNIGHT, "bN"},
+	{BLACK, BISHOP, "bB"},
+	{BLACK, QUEEN, "bQ"},
+	{BLACK, KING, "bK"}
+};
 
-Piece *Piece_clone(Piece *src) {
-	Piece *p = malloc(sizeof(Piece));
-	p->color = src->color;
-	p->shape = src->shape;
-	p->symbol = strdup(src->symbol);
-	return p;
-}
+extern inline const Piece *Piece_get(int shape, int color);
+
+extern inline const Piece *Piece_from_code(uint8_t code);
 
-Piece *Piece_parse(char *symbol) {
+const Piece *Piece_parse(char *symbol) {
 	int color;
 	if (symbol[0] == 'b') {
 		color = BLACK;
@@ -55,12 +41,12 @@ Piece *Piece_parse(char *symbol) {
 		exit(1);
 	}
 	switch(symbol[1]) {
-		case 'p':	return Piece_create(PAWN, color);
-		case 'R':	return Piece_create(ROOK, color);
-		case 'N':	return Piece_create(KNIGHT, color);
-		case 'B':	return Piece_create(BISHOP, color);
-		case 'Q':	return Piece_create(QUEEN, color);
-		case 'K': 	return Piece_create(KING, color);
+		case 'p':	return Piece_get(PAWN, color);
+		case 'R':	return Piece_get(ROOK, color);
+		case 'N':	return Piece_get(KNIGHT, color);
+		case 'B':	return Piece_get(BISHOP, color);
+		case 'Q':	return Piece_get(QUEEN, color);
+		case 'K': 	return Piece_get(KING, color);
 		default:
 			fprintf(stderr, "Invalid piece shape while parsing piece: '%c'", symbol[1]);
 			exit(1);
@@ -68,26 +54,20 @@ Piece *Piece_parse(char *symbol) {
 	return NULL;
 }
 
-void Piece_destroy(Piece *p) {
-	assert(p != NULL);
-	free(p->symbol);
-	free(p);
-}
-
-char *Piece_short_name(Piece *p) {
+char *Piece_short_name(const Piece *p) {
 	return p->symbol;
 }
 
-bool Piece_matches(Piece *p, int shape, int color) {
+bool Piece_matches(const Piece *p, int shape, int color) {
 	return p->shape == shape && p->color == color;
 }
 
-bool Piece_equals(Piece *left, Piece *right) {
+bool Piece_equals(const Piece *left, const Piece *right) {
 	if (right == NULL) return false;
 	return Piece_matches(left, right->shape, right->color);
 }
 
-void Piece_print_color(Piece *p) {
+void Piece_print_color(const Piece *p) {
 	if (p == NULL) {
 		printf(" ");
 	} else {
@@ -113,7 +93,7 @@ void Piece_print_color(Piece *p) {
 	}
 }
 
-void Piece_print(Piece *p) {
+void Piece_print(const Piece *p) {
 	if (p == NULL) {
 		#ifdef UNICODE_OUTPUT
 		printf(" ");
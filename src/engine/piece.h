@@ -1,4 +1,5 @@
 #include <stdbool.h>
+#include <stdint.h>
 #include "common.h"
 #include "datatypes.h"
 
@@ -11,46 +12,58 @@
 #ifndef _PIECE_H_
 #define _PIECE_H_
 
+/// Compact code of a piece, as stored in Board.fields: 1-6 for
+/// the white pieces and 7-12 for the black ones. 0 means empty.
+#define PIECE_CODE(shape, color) ((shape) + ((color) == WHITE ? 1 : 7))
+
+/// The twelve pieces, indexed by piece code. Use Piece_get instead.
+extern const Piece PIECES[13];
+
 /**
- * Creates a Piece instance of given shape and color
+ * Returns the (shared) Piece of given shape and color
  */
-Piece *Piece_create(int shape, int color);
-
-Piece *Piece_clone(Piece *src);
+inline const Piece *Piece_get(int shape, int color) {
+	return &PIECES[PIECE_CODE(shape, color)];
+}
 
 /**
- * Creates a Piece instance by its symbol, e.g. 'bN' for a black Knight.
+ * Returns the Piece for a piece code, or NULL for code 0.
  */
-Piece *Piece_parse(char *symbol);
+inline const Piece *Piece_from_code(uint8_t code) {
+	return code ? &PIECES[code] : NULL;
+}
 
-void Piece_destroy(Piece *p);
+/**
+ * Returns the Piece by its symbol, e.g. 'bN' for a black Knight.
+ */
+const Piece *Piece_parse(char *symbol);
 
 /**
  * Returns the short name or symbol of a Piece, e.g.
  * 'bN' for black Knight.
  */
-char *Piece_short_name(Piece *p);
+char *Piece_short_name(const Piece *p);
 
 /**
  * Returns true if the piece matches certain shape and color.
  */
-bool Piece_matches(Piece *p, int shape, int color);
+bool Piece_matches(const Piece *p, int shape, int color);
 
 /**
  * Returns true if the two pieces are of the same shape and color.
  */
-bool Piece_equals(Piece *left, Piece *right);
+bool Piece_equals(const Piece *left, const Piece *right);
 
 /**
  * Prints a piece to the console, using padding (spaces)
  * and (if possible) unicode symbols.
  * Pass NULL to display an empty field.
  */
-void Piece_print(Piece *p);
+void Piece_print(const Piece *p);
 
 /**
  * Like Piece_print(Piece*), but in color.
  */
-void Piece_print_color(Piece *p);
+void Piece_print_color(const Piece *p);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "datatypes.h"
+#include "pool.h"
+#include "stats.h"
+
+#ifdef THREADS
+#include <sched.h>
+
+/// All workers, worker 0 is the main thread
+static Worker *workers = NULL;
+static int size = 0;
+
+/// Protects the fields below, and the statistics of sleeping workers
+static pthread_mutex_t sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+/// Signalled when the workers should wake up
+static pthread_cond_t wake_up = PTHREAD_COND_INITIALIZER;
+/// Signalled when a worker falls asleep
+static pthread_cond_t fell_asleep = PTHREAD_COND_INITIALIZER;
+/// Number of workers that are sleeping
+static int sleeping = 0;
+/// True while searching. Also read without the lock, by the workers
+static int active = false;
+/// Set to end the worker threads
+static bool quit = false;
+
+/// The worker of the current thread
+static __thread Worker *self = NULL;
+
+/**
+ * Thread function of the workers: sleeps until the pool is started,
+ * and then runs any Task it can find until the pool is stopped.
+ */
+static void *work(void *arg);
+
+
+void Pool_init(int threads) {
+	Pool_destroy();
+	size = threads;
+	workers = calloc(size, sizeof(Worker));
+	int i;
+	for (i = 0; i < size; i++) {
+		workers[i].id = i;
+		pthread_mutex_init(&workers[i].lock, NULL);
+	}
+	self = &workers[0];
+	for (i = 1; i < size; i++) {
+		pthread_create(&workers[i].thread, NULL, work, (void *) &workers[i]);
+	}
+}
+
+void Pool_destroy() {
+	if (workers == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&sleep_lock);
+	quit = true;
+	pthread_cond_broadcast(&wake_up);
+	pthread_mutex_unlock(&sleep_lock);
+	int i;
+	for (i = 1; i < size; i++) {
+		pthread_join(workers[i].thread, NULL);
+	}
+	for (i = 0; i < size; i++) {
+		pthread_mutex_destroy(&workers[i].lock);
+	}
+	free(workers);
+	workers = NULL;
+	self = NULL;
+	size = 0;
+	sleeping = 0;
+	quit = false;
+}
+
+int Pool_size() {
+	return size;
+}
+
+Worker *Pool_worker(int id) {
+	return &workers[id];
+}
+
+Worker *Pool_self() {
+	return self;
+}
+
+void Pool_start() {
+	pthread_mutex_lock(&sleep_lock);
+	int i;
+	for (i = 0; i < size; i++) {
+		workers[i].stats = (Stats) {0, 0, 0};
+	}
+	__atomic_store_n(&active, true, __ATOMIC_RELAXED);
+	pthread_cond_broadcast(&wake_up);
+	pthread_mutex_unlock(&sleep_lock);
+}
+
+void Pool_stop(Stats *stats) {
+	pthread_mutex_lock(&sleep_lock);
+	__atomic_store_n(&active, false, __ATOMIC_RELAXED);
+	while (sleeping < size - 1) {
+		pthread_cond_wait(&fell_asleep, &sleep_lock);
+	}
+	int i;
+	for (i = 0; i < size; i++) {
+		assert(workers[i].top == workers[i].bottom);
+		stats->moves_count += workers[i].stats.moves_count;
+		stats->boards_evaluated += workers[i].stats.boards_evaluated;
+	}
+	pthread_mutex_unlock(&sleep_lock);
+}
+
+void Pool_push(Worker *worker, Task *task) {
+	pthread_mutex_lock(&worker->lock);
+	assert(worker->bottom - worker->top < POOL_DEQUE_SIZE);
+	worker->deque[worker->bottom % POOL_DEQUE_SIZE] = task;
+	worker->bottom++;
+	pthread_mutex_unlock(&worker->lock);
+}
+
+Task *Pool_pop(Worker *worker) {
+	Task *task = NULL;
+	pthread_mutex_lock(&worker->lock);
+	if (worker->bottom > worker->top) {
+		worker->bottom--;
+		task = worker->deque[worker->bottom % POOL_DEQUE_SIZE];
+	}
+	if (worker->bottom == worker->top) {
+		worker->bottom = worker->top = 0;
+	}
+	pthread_mutex_unlock(&worker->lock);
+	return task;
+}
+
+Task *Pool_steal(Worker *thief) {
+	int i;
+	// Start at the next worker, so not everyone robs the same one
+	for (i = 1; i < size; i++) {
+		Worker *victim = &workers[(thief->id + i) % size];
+		Task *task = NULL;
+		pthread_mutex_lock(&victim->lock);
+		if (victim->bottom > victim->top) {
+			task = victim->deque[victim->top % POOL_DEQUE_SIZE];
+			victim->top++;
+		}
+		if (victim->bottom == victim->top) {
+			victim->bottom = victim->top = 0;
+		}
+		pthread_mutex_unlock(&victim->lock);
+		if (task != NULL) {
+			return task;
+		}
+	}
+	return NULL;
+}
+
+static void *work(void *arg) {
+	Worker *worker = (Worker *) arg;
+	self = worker;
+	pthread_mutex_lock(&sleep_lock);
+	while (true) {
+		sleeping++;
+		pthread_cond_broadcast(&fell_asleep);
+		while (!active && !quit) {
+			pthread_cond_wait(&wake_up, &sleep_lock);
+		}
+		sleeping--;
+		if (quit) {
+			break;
+		}
+		pthread_mutex_unlock(&sleep_lock);
+		while (__atomic_load_n(&active, __ATOMIC_RELAXED)) {
+			Task *task = Pool_pop(worker);
+			if (task == NULL) {
+				task = Pool_steal(worker);
+			}
+			if (task != NULL) {
+				task->run(task, worker);
+			} else {
+				sched_yield();
+			}
+		}
+		pthread_mutex_lock(&sleep_lock);
+	}
+	pthread_mutex_unlock(&sleep_lock);
+	return NULL;
+}
+
+#endif
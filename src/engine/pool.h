@@ -0,0 +1,126 @@
+#include <stdbool.h>
+#include "common.h"
+#include "datatypes.h"
+#include "heuristics.h"
+#include "stats.h"
+
+#ifdef THREADS
+#include <pthread.h>
+#endif
+
+/**
+ * pool.h / pool.c
+ *
+ * A pool of worker threads that is started once and then reused for every
+ * search. Each worker has a double-ended queue (deque) of Tasks. A worker
+ * pushes and pops Tasks at the bottom of its own deque, and when that is
+ * empty it steals a Task from the top of the deque of another worker.
+ * While the pool is not searching, the workers sleep.
+ *
+ * Worker 0 is the thread that calls Pool_init (the main thread). It has a
+ * deque like the others, so it can hand out work, but it never runs the
+ * loop that steals Tasks.
+ *
+ * Only available when compiled with THREADS.
+ *
+ */
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#ifdef THREADS
+
+/// Maximum number of Tasks in the deque of one worker
+#define POOL_DEQUE_SIZE (64)
+
+typedef struct Worker Worker;
+typedef struct Task Task;
+
+/**
+ * A piece of work that can be handed to other threads. Embed it as
+ * the first member of a struct holding the details of the work.
+ */
+struct Task {
+	/// Does the work, called by the worker that took the Task
+	void (*run)(Task *task, Worker *worker);
+};
+
+/**
+ * A thread in the pool, with the state that it needs for searching.
+ */
+struct Worker {
+	/// Index in the pool, 0 for the main thread
+	int id;
+	pthread_t thread;
+	/// Protects the deque
+	pthread_mutex_t lock;
+	/// The deque, the top is the oldest Task
+	Task *deque[POOL_DEQUE_SIZE];
+	int top;
+	int bottom;
+	/// Board to search on
+	Board board;
+	/// Statistics of this worker, reset by Pool_start
+	Stats stats;
+	/// Move ordering heuristics, kept from search to search
+	Heuristics heuristics;
+};
+
+/**
+ * Starts a pool of the given number of threads, including the calling
+ * thread. If a pool is already running it is stopped first.
+ */
+void Pool_init(int threads);
+
+/**
+ * Stops all worker threads and frees the pool.
+ */
+void Pool_destroy();
+
+/**
+ * Number of threads in the pool, including the main thread.
+ * 0 if there is no pool.
+ */
+int Pool_size();
+
+/**
+ * Returns the worker with the given index.
+ */
+Worker *Pool_worker(int id);
+
+/**
+ * Returns the worker of the calling thread.
+ */
+Worker *Pool_self();
+
+/**
+ * Wakes up the workers, which start looking for Tasks,
+ * and resets their statistics.
+ */
+void Pool_start();
+
+/**
+ * Puts the workers back to sleep. Waits until they all are, and adds
+ * the statistics of all workers, the main thread's included, to `stats`. There must be no Tasks left.
+ */
+void Pool_stop(Stats *stats);
+
+/**
+ * Adds a Task to the bottom of the deque of the given worker.
+ */
+void Pool_push(Worker *worker, Task *task);
+
+/**
+ * Takes the Task from the bottom of the deque of the given
+ * worker, or returns NULL if it's empty.
+ */
+Task *Pool_pop(Worker *worker);
+
+/**
+ * Takes the oldest Task from the deque of another worker,
+ * or returns NULL if there is none.
+ */
+Task *Pool_steal(Worker *thief);
+
+#endif
+
+#endif
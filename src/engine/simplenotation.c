@@ -32,32 +32,18 @@ char * Simple_move_format(Board *board, Move *m, int include_promotion) {
 
 Move *Simple_move_parse(char *str, Board *board) {
 	// Generate all moves:
-	Move *head = Move_alloc();
-	int color = Board_turn(board);
-	int total = v_get_all_valid_moves_for_color(&head, board, color);
-	if (total == 0) {
-		Move_destroy(head);
-		return NULL;
-	}
-
-	int any = false;
-	Move *curr = head;
-	while (curr) {
-		char *move = Simple_move_format(board, curr, false);
-		if (strcmp(str, move) == 0) {
-			any = true;
-			free(move);
-			break;
+	MoveList moves;
+	int total = v_get_moves(&moves, board, Board_turn(board));
+	int i;
+	for (i = 0; i < total; i++) {
+		Move move;
+		Move_decode(moves.moves[i], &move);
+		char *str_move = Simple_move_format(board, &move, false);
+		int found = (strcmp(str, str_move) == 0);
+		free(str_move);
+		if (found) {
+			return Move_clone(&move);
 		}
-		free(move);
-		curr = curr->next_sibling;
 	}
-	// Make a copy, so the rest can easily be destroyed in 1 go:
-	if (any) {
-		Move *result = Move_clone(curr);
-		Move_destroy(head);
-		return result;
-	}
-
 	return NULL;
 }
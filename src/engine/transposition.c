@@ -0,0 +1,158 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "datatypes.h"
+#include "move.h"
+#include "transposition.h"
+
+/// Entries per bucket, four entries of 16 bytes fill a cache line
+#define BUCKET_SIZE (4)
+
+/**
+ * One slot in the table. `data` holds the packed Transposition
+ * (see pack), `key` is the hash XOR-ed with `data`.
+ */
+typedef struct Entry {
+	uint64_t key;
+	uint64_t data;
+} Entry;
+
+/// The table, BUCKET_SIZE * (bucket_mask + 1) entries
+static Entry *table = NULL;
+/// Number of buckets - 1, the number of buckets is a power of two
+static uint64_t bucket_mask = 0;
+/// Counts the searches, stored with each entry to tell old entries apart
+static unsigned int generation = 0;
+
+/**
+ * Packs a Transposition and the current generation in 64 bits:
+ * 32 bits of score, 16 bits of move, 8 bits of depth,
+ * 2 bits of bound and 6 bits of generation.
+ */
+static uint64_t pack(int score, int depth, int bound, uint32_t move);
+
+/**
+ * Reverses pack.
+ */
+static void unpack(uint64_t data, Transposition *out);
+
+/**
+ * Returns the generation an entry was stored in.
+ */
+static unsigned int age_of(uint64_t data);
+
+/**
+ * Returns the depth of an entry.
+ */
+static int depth_of(uint64_t data);
+
+
+void Transposition_init(int megabytes) {
+	Transposition_destroy();
+	uint64_t buckets = ((uint64_t) megabytes << 20) / (BUCKET_SIZE * sizeof(Entry));
+	// Round down to a power of two:
+	uint64_t size = 1;
+	while (size * 2 <= buckets) {
+		size *= 2;
+	}
+	table = calloc(size * BUCKET_SIZE, sizeof(Entry));
+	if (table == NULL) {
+		fprintf(stderr, "Unable to allocate a transposition table of %d megabytes!\n", megabytes);
+		exit(1);
+	}
+	bucket_mask = size - 1;
+	generation = 0;
+}
+
+void Transposition_destroy() {
+	free(table);
+	table = NULL;
+	bucket_mask = 0;
+}
+
+void Transposition_clear() {
+	memset(table, 0, (bucket_mask + 1) * BUCKET_SIZE * sizeof(Entry));
+}
+
+void Transposition_new_search() {
+	generation = (generation + 1) & 63;
+}
+
+bool Transposition_probe(uint64_t hash, Transposition *out) {
+	Entry *bucket = &table[(hash & bucket_mask) * BUCKET_SIZE];
+	int i;
+	for (i = 0; i < BUCKET_SIZE; i++) {
+		uint64_t key = __atomic_load_n(&bucket[i].key, __ATOMIC_RELAXED);
+		uint64_t data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+		// A torn entry won't pass this check
+		if ((key ^ data) == hash && data != 0) {
+			unpack(data, out);
+			return true;
+		}
+	}
+	return false;
+}
+
+void Transposition_store(uint64_t hash, int score, int depth, int bound, uint32_t move) {
+	Entry *bucket = &table[(hash & bucket_mask) * BUCKET_SIZE];
+	Entry *victim = NULL;
+	int victim_value = 0;
+	int i;
+	for (i = 0; i < BUCKET_SIZE; i++) {
+		uint64_t key = __atomic_load_n(&bucket[i].key, __ATOMIC_RELAXED);
+		uint64_t data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+		if (data == 0) {
+			// Empty
+			victim = &bucket[i];
+			break;
+		}
+		if ((key ^ data) == hash) {
+			// Same position, keep it if it's a deeper result of this search
+			if (depth < depth_of(data) && bound != BOUND_EXACT && age_of(data) == generation) {
+				return;
+			}
+			victim = &bucket[i];
+			break;
+		}
+		// Prefer to replace old and shallow entries
+		int value = depth_of(data) - 4 * ((generation - age_of(data)) & 63);
+		if (victim == NULL || value < victim_value) {
+			victim = &bucket[i];
+			victim_value = value;
+		}
+	}
+	uint64_t data = pack(score, depth, bound, move);
+	__atomic_store_n(&victim->key, hash ^ data, __ATOMIC_RELAXED);
+	__atomic_store_n(&victim->data, data, __ATOMIC_RELAXED);
+}
+
+static uint64_t pack(int score, int depth, int bound, uint32_t move) {
+	if (depth < 0) {
+		depth = 0;
+	} else if (depth > 255) {
+		depth = 255;
+	}
+	return (uint64_t) (uint32_t) score
+		| (uint64_t) MOVE_ID(move) << 32
+		| (uint64_t) depth << 48
+		| (uint64_t) bound << 56
+		| (uint64_t) generation << 58;
+}
+
+static void unpack(uint64_t data, Transposition *out) {
+	out->score = (int32_t) (uint32_t) data;
+	out->move = (data >> 32) & 0xFFFF;
+	out->depth = (data >> 48) & 0xFF;
+	out->bound = (data >> 56) & 3;
+}
+
+static unsigned int age_of(uint64_t data) {
+	return data >> 58;
+}
+
+static int depth_of(uint64_t data) {
+	return (data >> 48) & 0xFF;
+}
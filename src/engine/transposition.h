@@ -0,0 +1,84 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "datatypes.h"
+
+/**
+ * transposition.h / transposition.c
+ *
+ * The transposition table: a hash table, keyed by the Zobrist hash of a
+ * position (Board.hash), that remembers what an earlier search found out
+ * about that position. When the same position is reached again through
+ * another order of moves, or in the next turn, the search can use the
+ * stored score, or at least try the stored best move first.
+ *
+ * There is one table, shared by all search threads without locks. Each
+ * entry is two 64-bit words: the packed data, and the hash XOR-ed with
+ * that data. An entry that was half overwritten by another thread then
+ * simply fails to match its key, so torn reads are thrown away instead of
+ * being used.
+ *
+ * The table consists of buckets of a few entries. When a bucket is full,
+ * the entry that is the least useful is replaced: shallow entries and
+ * entries from earlier turns go first.
+ *
+ */
+#ifndef _TRANSPOSITION_H_
+#define _TRANSPOSITION_H_
+
+/// The stored score is the exact value of the position
+#define BOUND_EXACT (1)
+/// The value is at least the stored score (a beta cut-off for white)
+#define BOUND_LOWER (2)
+/// The value is at most the stored score (an alpha cut-off for black)
+#define BOUND_UPPER (3)
+
+/**
+ * What the table knows about a position.
+ * Scores are from white's point of view, like everywhere in the engine.
+ */
+typedef struct Transposition {
+	/// Evaluation, or a bound on it, see `bound`
+	int score;
+	/// Remaining ply depth of the search that found the score
+	int depth;
+	/// BOUND_EXACT, BOUND_LOWER or BOUND_UPPER
+	int bound;
+	/// Best move found, as MOVE_ID, or 0 if none
+	uint32_t move;
+} Transposition;
+
+/**
+ * Allocates the table, using at most the given number of megabytes.
+ * The number of entries is rounded down to a power of two.
+ * Can be called again to resize the table, but not while searching.
+ */
+void Transposition_init(int megabytes);
+
+/**
+ * Frees the table.
+ */
+void Transposition_destroy();
+
+/**
+ * Empties the table.
+ */
+void Transposition_clear();
+
+/**
+ * Tells the table a new search is starting, so
+ * the entries of earlier searches are replaced first.
+ */
+void Transposition_new_search();
+
+/**
+ * Looks up a position. Returns true and fills `out` if it was found.
+ */
+bool Transposition_probe(uint64_t hash, Transposition *out);
+
+/**
+ * Stores what the search found out about a position.
+ * Safe to call from several threads at once.
+ */
+void Transposition_store(uint64_t hash, int score, int depth, int bound, uint32_t move);
+
+#endif
@@ -9,31 +9,94 @@
 #include "move.h"
 #include "piece.h"
 #include "square.h"
+#include "bitboard.h"
 #include "board.h"
 #include "validator.h"
 
 #ifndef _VALIDATOR_C_
 #define _VALIDATOR_C_
 
-static bool contains(Move *first, Move *needle);
+/// Generate every move
+#define GENERATE_ALL (0)
+/// Only generate captures, including en passant, and promotions
+#define GENERATE_CAPTURES (1)
+/// Only generate the moves that GENERATE_CAPTURES leaves out
+#define GENERATE_QUIETS (2)
+/// Only generate moves that get out of check, for a player that is at check
+#define GENERATE_EVASIONS (3)
 
-static void add_move(Move **head, Move *move);
+/**
+ * Everything needed to generate only legal moves for one player,
+ * computed once per position by get_legality. With this, no
+ * move needs to be made and undone to see if it leaves the King in check.
+ */
+typedef struct Legality {
+	/// Square of the player's King
+	int king;
+	/// Square of the opponent's King, or -1 if there isn't exactly one
+	int enemy_king;
+	/// Opponent's pieces that give check
+	Bitboard checkers;
+	/// Target squares that resolve a check: every square when not in check,
+	/// the checker and the squares between it and the King when in single check,
+	/// none when in double check.
+	Bitboard check_mask;
+	/// Own pieces that may only move along the line to their own King
+	Bitboard pinned;
+	/// Own pieces that give a discovered check when moving off the line
+	/// between an own slider and the opponent's King
+	Bitboard discoverers;
+	/// Squares the King can move to without being in check
+	Bitboard king_targets;
+} Legality;
 
-static void add_move_pawn(Move **head, int color, int x, int y, int xx, int yy);
+static bool get_legality(Board *board, int color, Legality *legal);
 
-static int get_all_valid_moves_of_piece(Move **head, Board *board, int i, int j, bool only_count);
+/**
+ * Fills the list with the valid moves of the given kind (GENERATE_*)
+ * for the given color, and returns the number of moves.
+ */
+static int get_moves(MoveList *list, Board *board, int color, int kind);
 
-static int get_valid_moves_pawn(Move **head, Board *board, int x, int y, int color, bool only_count);
+/**
+ * Returns the squares a piece may move to when generating
+ * moves of the given kind, not counting pawn specialties.
+ */
+static Bitboard kind_targets(Board *board, int color, int kind);
 
-static int get_valid_moves_knight(Move **head, Board *board, int x, int y, int color, bool only_count);
+static Bitboard single_blockers(Board *board, int sq, Bitboard snipers);
 
-static int get_valid_moves_rook(Move **head, Board *board, int x, int y, int color, bool only_count);
+static Bitboard legal_targets(Legality *legal, int sq);
 
-static int get_valid_moves_bishop(Move **head, Board *board, int x, int y, int color, bool only_count);
+static bool square_attacked(Board *board, int sq, int color, Bitboard occupancy);
 
-static int get_valid_moves_queen(Move **head, Board *board, int x, int y, int color, bool only_count);
+static bool en_passant_is_legal(Board *board, Legality *legal, int x, int y, int xx, int color);
 
-static int get_valid_moves_king(Move **head, Board *board, int x, int y, int color, bool only_count);
+static bool move_gives_check(Board *board, Legality *legal, uint32_t code, int shape, int color);
+
+static bool contains(MoveList *list, Move *needle);
+
+static void prepend_move(Move **head, Move *move);
+
+static void add_move(MoveList *list, int from, int to, int promotion);
+
+static int add_moves(MoveList *list, int from, Bitboard targets);
+
+static int add_move_pawn(MoveList *list, int from, int to);
+
+static int get_all_valid_moves_of_piece(MoveList *list, Board *board, int i, int j, Legality *legal, int kind);
+
+static int get_valid_moves_pawn(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind);
+
+static int get_valid_moves_knight(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind);
+
+static int get_valid_moves_rook(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind);
+
+static int get_valid_moves_bishop(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind);
+
+static int get_valid_moves_queen(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind);
+
+static int get_valid_moves_king(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind);
 
 static bool gives_check(Board *board, Move *move, int color);
 
@@ -41,14 +104,14 @@ static void add_square(Square **head, Square *square);
 
 #endif
 
-static bool contains(Move *first, Move *needle) {
-	Move *curr;
-	curr = first;
-	while(curr) {
-		if (Move_equals(curr, needle)) {
+static bool contains(MoveList *list, Move *needle) {
+	int from = SQUARE(needle->x, needle->y);
+	int to = SQUARE(needle->xx, needle->yy);
+	int i;
+	for (i = 0; i < list->count; i++) {
+		if (MOVE_FROM(list->moves[i]) == from && MOVE_TO(list->moves[i]) == to) {
 			return true;
 		}
-		curr = curr->next_sibling;
 	}
 	return false;
 }
@@ -57,195 +120,176 @@ static bool gives_check(Board *board, Move *move, int color) {
 	if (Move_is_nullmove(move)) {
 		return false;
 	}
-	UndoableMove *umove = Board_do_move(board, move);
-	int kingI = -1, kingJ = -1;
-	int i, j;
-	for (i = 0; i < 8; i++) {
-		for (j = 0; j < 8; j++) {
-			if (Board_is_at(board, i, j, KING, color)) {
-				kingI = i; kingJ = j;
-				break;
-			}
-		}
-	}
-	if (kingI == -1) {
-		Board_undo_move(board, umove);
-		Undo_destroy(umove);
-		return true;
-	}
-	int result = v_square_gives_check(board, kingI, kingJ, color);
-	Board_undo_move(board, umove);
-	Undo_destroy(umove);
+	UndoableMove umove;
+	Board_make_move(board, move, &umove);
+	int king = Board_king_square(board, color);
+	int result = (king == -1)
+		|| v_square_gives_check(board, SQUARE_X(king), SQUARE_Y(king), color);
+	Board_undo_move(board, &umove);
 	return result;
 }
 
 
 bool v_king_at_check(Board *board, int color) {
-	int kingI = -1, kingJ = -1;
-	int i, j;
-	for (i = 0; i < 8; i++) {
-		for (j = 0; j < 8; j++) {
-			if (Board_is_at(board, i, j, KING, color)) {
-				kingI = i; kingJ = j;
-			}
-		}
-	}
-	if (kingI == -1) {
+	int king = Board_king_square(board, color);
+	if (king == -1) {
 		return true;
 	}
-	return v_square_gives_check(board, kingI, kingJ, color);
+	return v_square_gives_check(board, SQUARE_X(king), SQUARE_Y(king), color);
 }
 
 
 bool v_square_gives_check(Board *board, int x, int y, int color) {
-	// Pawns
-	if (color== WHITE) {
-		if (Board_is_at_safe(board, x-1, y-1, PAWN, BLACK) || Board_is_at_safe(board, x+1, y-1, PAWN, BLACK)) {
-			return true;
+	return square_attacked(board, SQUARE(x, y), color, board->occupancy);
+}
+
+
+static bool square_attacked(Board *board, int sq, int color, Bitboard occupancy) {
+	Bitboard *enemy = board->pieces[COLOR_INDEX(-color)];
+	return (Bitboard_pawn_attacks(color, sq) & enemy[PAWN])
+		|| (Bitboard_knight_attacks(sq) & enemy[KNIGHT])
+		|| (Bitboard_rook_attacks(sq, occupancy) & (enemy[ROOK] | enemy[QUEEN]))
+		|| (Bitboard_bishop_attacks(sq, occupancy) & (enemy[BISHOP] | enemy[QUEEN]))
+		|| (Bitboard_king_attacks(sq) & enemy[KING]);
+}
+
+
+static Bitboard single_blockers(Board *board, int sq, Bitboard snipers) {
+	Bitboard blockers = 0;
+	while (snipers) {
+		Bitboard between = Bitboard_between(sq, Bitboard_pop(&snipers)) & board->occupancy;
+		if (Bitboard_count(between) == 1) {
+			blockers |= between;
 		}
-	} else if (color== BLACK) {
-		if (Board_is_at_safe(board, x-1, y+1, PAWN, WHITE) || Board_is_at_safe(board, x+1, y+1, PAWN, WHITE)) {
-			return true;
+	}
+	return blockers;
+}
+
+
+static bool get_legality(Board *board, int color, Legality *legal) {
+	Bitboard *own = board->pieces[COLOR_INDEX(color)];
+	Bitboard *enemy = board->pieces[COLOR_INDEX(-color)];
+	// Hand-made boards may have no King, or several. Let the caller
+	// fall back to making every move and looking for check.
+	if (Bitboard_count(own[KING]) != 1) {
+		return false;
+	}
+	int king = Bitboard_first(own[KING]);
+	legal->king = king;
+	legal->enemy_king = Bitboard_count(enemy[KING]) == 1 ? Bitboard_first(enemy[KING]) : -1;
+
+	// Check evasions
+	legal->checkers = (Bitboard_pawn_attacks(color, king) & enemy[PAWN])
+		| (Bitboard_knight_attacks(king) & enemy[KNIGHT])
+		| (Bitboard_rook_attacks(king, board->occupancy) & (enemy[ROOK] | enemy[QUEEN]))
+		| (Bitboard_bishop_attacks(king, board->occupancy) & (enemy[BISHOP] | enemy[QUEEN]));
+	int checks = Bitboard_count(legal->checkers);
+	if (checks == 0) {
+		legal->check_mask = ~0ULL;
+	} else if (checks == 1) {
+		legal->check_mask = legal->checkers | Bitboard_between(king, Bitboard_first(legal->checkers));
+	} else {
+		legal->check_mask = 0;
+	}
+
+	// Pins: enemy sliders that would see the King if one own piece moved away
+	Bitboard snipers = (Bitboard_rook_attacks(king, 0) & (enemy[ROOK] | enemy[QUEEN]))
+		| (Bitboard_bishop_attacks(king, 0) & (enemy[BISHOP] | enemy[QUEEN]));
+	legal->pinned = single_blockers(board, king, snipers) & board->occupied[COLOR_INDEX(color)];
+
+	// Discovered checks: the same, but for own sliders and the enemy King
+	legal->discoverers = 0;
+	if (legal->enemy_king != -1) {
+		snipers = (Bitboard_rook_attacks(legal->enemy_king, 0) & (own[ROOK] | own[QUEEN]))
+			| (Bitboard_bishop_attacks(legal->enemy_king, 0) & (own[BISHOP] | own[QUEEN]));
+		legal->discoverers = single_blockers(board, legal->enemy_king, snipers)
+			& board->occupied[COLOR_INDEX(color)];
+	}
+
+	// The King is left out of the occupancy, so it can't step
+	// back along the line of a slider that checks it.
+	Bitboard targets = Bitboard_king_attacks(king) & ~board->occupied[COLOR_INDEX(color)];
+	Bitboard occupancy = board->occupancy & ~own[KING];
+	legal->king_targets = 0;
+	while (targets) {
+		int sq = Bitboard_pop(&targets);
+		if (!square_attacked(board, sq, color, occupancy)) {
+			legal->king_targets |= 1ULL << sq;
 		}
 	}
-	// Knights
-	if (Board_is_at_safe(board, x-1, y-2, KNIGHT, -color)
-		|| Board_is_at_safe(board, x+1, y-2, KNIGHT, -color)
-		|| Board_is_at_safe(board, x-1, y+2, KNIGHT, -color)
-		|| Board_is_at_safe(board, x+1, y+2, KNIGHT, -color)
-		|| Board_is_at_safe(board, x-2, y-1, KNIGHT, -color)
-		|| Board_is_at_safe(board, x+2, y-1, KNIGHT, -color)
-		|| Board_is_at_safe(board, x-2, y+1, KNIGHT, -color)
-		|| Board_is_at_safe(board, x+2, y+1, KNIGHT, -color)) {
+	return true;
+}
+
+
+static Bitboard legal_targets(Legality *legal, int sq) {
+	if (legal == NULL) {
+		return ~0ULL;
+	}
+	if (legal->pinned & (1ULL << sq)) {
+		return legal->check_mask & Bitboard_line(legal->king, sq);
+	}
+	return legal->check_mask;
+}
+
+
+static bool en_passant_is_legal(Board *board, Legality *legal, int x, int y, int xx, int color) {
+	if (legal == NULL) {
 		return true;
 	}
+	// The captured pawn is not on the target square, so the check and pin masks
+	// don't apply. Instead, remove both pawns and look for check directly.
+	Bitboard captured = SQUARE_BIT(xx, y);
+	Bitboard target = SQUARE_BIT(xx, y - color);
+	if (!(legal->check_mask & (captured | target))) {
+		return false;
+	}
+	Bitboard occupancy = (board->occupancy & ~SQUARE_BIT(x, y) & ~captured) | target;
+	Bitboard *enemy = board->pieces[COLOR_INDEX(-color)];
+	return !(Bitboard_rook_attacks(legal->king, occupancy) & (enemy[ROOK] | enemy[QUEEN]))
+		&& !(Bitboard_bishop_attacks(legal->king, occupancy) & (enemy[BISHOP] | enemy[QUEEN]));
+}
 
-	int i, j;
-	Piece *p;
-	// Rook and Queen
-	i = x - 1; // left
-	while (i >= 0) {
-		p = Board_get_piece(board, i, y);
-		if (p != NULL) {
-			if (p->color == -color && (p->shape == ROOK || p->shape == QUEEN)) {
-				return true;
-			} else {
-				break;
-			}
-		}
-		i = i - 1;
-	}
-	i = x + 1; // right
-	while (i <= 7) {
-		p = Board_get_piece(board, i, y);
-		if (p != NULL) {
-			if (p->color == -color && (p->shape == ROOK || p->shape == QUEEN)) {
-				return true;
-			} else {
-				break;
-			}
-		}
-		i = i + 1;
-	}
-	i = y - 1;
-	while (i >= 0) {
-		p = Board_get_piece(board, x, i);
-		if (p != NULL) {
-			if (p->color == -color && (p->shape == ROOK || p->shape == QUEEN)) {
-				return true;
-			} else {
-				break;
-			}
-		}
-		i = i - 1;
-	}
-	i = y + 1;
-	while (i <= 7) {
-		p = Board_get_piece(board, x, i);
-		if (p != NULL) {
-			if (p->color == -color && (p->shape == ROOK || p->shape == QUEEN)) {
-				return true;
-			} else {
-				break;
-			}
-		}
-		i = i + 1;
-	}
-	// Bishop && Queen
-	i = x - 1; // top left
-	j = y - 1;
-	while (i >= 0 && j >= 0) {
-		p = Board_get_piece(board, i, j);
-		if (p != NULL) {
-			if (p->color == -color && (p->shape == BISHOP || p->shape == QUEEN)) {
-				return true;
-			} else {
-				break;
-			}
-		}
-		i = i - 1;
-		j = j - 1;
-	}
-	i = x - 1; // bottom left
-	j = y + 1;
-	while (i >= 0 && j <= 7) {
-		p = Board_get_piece(board, i, j);
-		if (p != NULL) {
-			if (p->color == -color && (p->shape == BISHOP || p->shape == QUEEN)) {
-				return true;
-			} else {
-				break;
-			}
-		}
-		i = i - 1;
-		j = j + 1;
-	}
-	i = x + 1; // top right
-	j = y - 1;
-	while (i <= 7 && j >= 0) {
-		p = Board_get_piece(board, i, j);
-		if (p != NULL) {
-			if (p->color == -color && (p->shape == BISHOP || p->shape == QUEEN)) {
-				return true;
-			} else {
-				break;
-			}
-		}
-		i = i + 1;
-		j = j - 1;
-	}
-	i = x + 1;
-	j = y + 1;
-	while (i <= 7 && j <= 7) {
-		p = Board_get_piece(board, i, j);
-		if (p != NULL) {
-			if (p->color == -color && (p->shape == BISHOP || p->shape == QUEEN)) {
-				return true;
-			} else {
-				break;
-			}
-		}
-		i = i + 1;
-		j = j + 1;
-	}
-	// King
-	if (Board_is_at_safe(board, x - 1, y, KING, -color)
-		|| Board_is_at_safe(board, x - 1, y - 1, KING, -color)
-		|| Board_is_at_safe(board, x - 1, y + 1, KING, -color)
-		|| Board_is_at_safe(board, x + 1, y, KING, -color)
-		|| Board_is_at_safe(board, x + 1, y - 1, KING, -color)
-		|| Board_is_at_safe(board, x + 1, y + 1, KING, -color)
-		|| Board_is_at_safe(board, x, y - 1, KING, -color)
-		|| Board_is_at_safe(board, x, y + 1, KING, -color)) {
+
+static bool move_gives_check(Board *board, Legality *legal, uint32_t code, int shape, int color) {
+	int from = MOVE_FROM(code);
+	int to = MOVE_TO(code);
+	// Castling and en passant move two pieces. They are rare enough to simply try.
+	if (legal == NULL || legal->enemy_king == -1
+			|| (shape == KING && abs(SQUARE_X(to) - SQUARE_X(from)) == 2)
+			|| (shape == PAWN && SQUARE_X(to) != SQUARE_X(from) && !(board->occupancy & (1ULL << to)))) {
+		Move move;
+		Move_decode(code, &move);
+		return gives_check(board, &move, -color);
+	}
+	Bitboard occupancy = (board->occupancy & ~(1ULL << from)) | (1ULL << to);
+	Bitboard king = 1ULL << legal->enemy_king;
+	// Discovered check
+	if ((legal->discoverers & (1ULL << from)) && !(Bitboard_line(legal->enemy_king, from) & (1ULL << to))) {
 		return true;
 	}
-	// Done.
-	return false;
+	// Direct check
+	if (MOVE_PROMOTION(code)) {
+		shape = MOVE_PROMOTION(code);
+	}
+	switch (shape) {
+		case PAWN:
+			return (Bitboard_pawn_attacks(color, to) & king) != 0;
+		case KNIGHT:
+			return (Bitboard_knight_attacks(to) & king) != 0;
+		case BISHOP:
+			return (Bitboard_bishop_attacks(to, occupancy) & king) != 0;
+		case ROOK:
+			return (Bitboard_rook_attacks(to, occupancy) & king) != 0;
+		case QUEEN:
+			return (Bitboard_queen_attacks(to, occupancy) & king) != 0;
+		default:
+			return false;
+	}
 }
 
 
 int v_get_rough_move_count_for_piece(Board *board, int x, int y) {
-	return get_all_valid_moves_of_piece(NULL, board, x, y, true);
+	return get_all_valid_moves_of_piece(NULL, board, x, y, NULL, GENERATE_ALL);
 }
 
 
@@ -258,97 +302,156 @@ bool v_is_valid_move(Board *board, Move *move) {
 		return false;
 	}
 	// A move is valid if it can be made and does not result in check of the current player
-	Move *validmoves = Move_alloc();
-	get_all_valid_moves_of_piece(&validmoves, board, move->x, move->y, false);
-	int is_valid = contains(validmoves, move);
-	int result = is_valid && !gives_check(board, move, Board_get_piece(board, move->x, move->y)->color);
-	Move_destroy(validmoves);
-	return result;
+	Legality legality;
+	Legality *legal = get_legality(board, Board_turn(board), &legality) ? &legality : NULL;
+	MoveList validmoves;
+	validmoves.count = 0;
+	get_all_valid_moves_of_piece(&validmoves, board, move->x, move->y, legal, GENERATE_ALL);
+	return contains(&validmoves, move);
 }
 
 
-int v_get_all_valid_moves_for_color(Move **head, Board *board, int color) {
-	int i, j;
-	int count = 0;
-	for (i = 0; i < 8; i++) {
-		for (j = 0; j < 8; j++) {
-			if (Board_is_color(board, i, j, color)) {
-				count += get_all_valid_moves_of_piece(head, board, i, j, false);
-			}
-		}
+int v_get_moves(MoveList *list, Board *board, int color) {
+	return get_moves(list, board, color, GENERATE_ALL);
+}
+
+
+int v_get_captures(MoveList *list, Board *board, int color) {
+	return get_moves(list, board, color, GENERATE_CAPTURES);
+}
+
+
+int v_get_quiets(MoveList *list, Board *board, int color) {
+	return get_moves(list, board, color, GENERATE_QUIETS);
+}
+
+
+int v_get_evasions(MoveList *list, Board *board, int color) {
+	return get_moves(list, board, color, GENERATE_EVASIONS);
+}
+
+
+static int get_moves(MoveList *list, Board *board, int color, int kind) {
+	list->count = 0;
+	Legality legality;
+	Legality *legal = get_legality(board, color, &legality) ? &legality : NULL;
+	Bitboard pieces = board->occupied[COLOR_INDEX(color)];
+	// In double check only the King can move
+	if (legal != NULL && legal->check_mask == 0) {
+		pieces = board->pieces[COLOR_INDEX(color)][KING];
+	} else if (legal != NULL && kind == GENERATE_EVASIONS) {
+		// A pinned piece can only move along its pin, and can
+		// never get in the way of another piece that gives check
+		pieces &= ~legal->pinned;
+	}
+	while (pieces) {
+		int sq = Bitboard_pop(&pieces);
+		get_all_valid_moves_of_piece(list, board, SQUARE_X(sq), SQUARE_Y(sq), legal, kind);
+	}
+	return list->count;
+}
+
+
+static Bitboard kind_targets(Board *board, int color, int kind) {
+	if (kind == GENERATE_CAPTURES) {
+		return board->occupied[COLOR_INDEX(-color)];
+	} else if (kind == GENERATE_QUIETS) {
+		return ~board->occupancy;
 	}
-	// Only happens when add_move is not called, i.e. no valid moves are found.
-	if (Move_is_nullmove(*head) && count > 0) {
-		fprintf(stderr, "Warning: v_get_all_valid_moves_for_color (length %d) starts with nullmove\n", count);
+	// Evasions are limited by the check mask of Legality
+	return ~0ULL;
+}
+
+
+uint32_t v_find_move(Board *board, int color, uint32_t move) {
+	int from = MOVE_FROM(move);
+	if (move == 0 || !(board->occupied[COLOR_INDEX(color)] & (1ULL << from))) {
 		return 0;
 	}
+	Legality legality;
+	Legality *legal = get_legality(board, color, &legality) ? &legality : NULL;
+	MoveList list;
+	list.count = 0;
+	get_all_valid_moves_of_piece(&list, board, SQUARE_X(from), SQUARE_Y(from), legal, GENERATE_ALL);
+	int i;
+	for (i = 0; i < list.count; i++) {
+		if (MOVE_ID(list.moves[i]) == MOVE_ID(move)) {
+			return list.moves[i];
+		}
+	}
+	return 0;
+}
+
+
+int v_get_all_valid_moves_for_color(Move **head, Board *board, int color) {
+	MoveList list;
+	int count = v_get_moves(&list, board, color);
+	int i;
+	for (i = 0; i < count; i++) {
+		Move *move = Move_alloc();
+		Move_decode(list.moves[i], move);
+		move->fitness = (color == WHITE ? MIN_FITNESS : MAX_FITNESS);
+		prepend_move(head, move);
+	}
 	return count;
 }
 
 
-static int get_all_valid_moves_of_piece(Move **head, Board *board, int i, int j, bool only_count) {
-	Piece *piece = Board_get_piece(board, i, j);
+static int get_all_valid_moves_of_piece(MoveList *list, Board *board, int i, int j, Legality *legal, int kind) {
+	const Piece *piece = Board_get_piece(board, i, j);
+	int start = (list == NULL ? 0 : list->count);
 	int count = 0;
 	// Get all possible moves for this piece
 	if (piece->shape == PAWN) {
-		count = get_valid_moves_pawn(head, board, i, j, piece->color, only_count);
+		count = get_valid_moves_pawn(list, board, i, j, piece->color, legal, kind);
 	} else if (piece->shape == KNIGHT) {
-		count = get_valid_moves_knight(head, board, i, j, piece->color, only_count);
+		count = get_valid_moves_knight(list, board, i, j, piece->color, legal, kind);
 	} else if (piece->shape == BISHOP) {
-		count = get_valid_moves_bishop(head, board, i, j, piece->color, only_count);
+		count = get_valid_moves_bishop(list, board, i, j, piece->color, legal, kind);
 	} else if (piece->shape == ROOK) {
-		count = get_valid_moves_rook(head, board, i, j, piece->color, only_count);
+		count = get_valid_moves_rook(list, board, i, j, piece->color, legal, kind);
 	} else if (piece->shape == QUEEN) {
-		count = get_valid_moves_queen(head, board, i, j, piece->color, only_count);
+		count = get_valid_moves_queen(list, board, i, j, piece->color, legal, kind);
 	} else if (piece->shape == KING) {
-		count = get_valid_moves_king(head, board, i, j, piece->color, only_count);
+		count = get_valid_moves_king(list, board, i, j, piece->color, legal, kind);
 	}
 
-	// When only_count enabled, skip the expensive checks and
+	// When only counting, skip the expensive checks and
 	// immediately return the rough estimate.
-	if (head == NULL) {
-		assert(only_count);
+	if (list == NULL) {
 		return count;
 	}
 
-	// Remove the moves that put the king in check
-	Move *curr = *head;
-	Move *prev = NULL;
-	int iter = 0;
-	int total = count;
-	while (curr && iter < total) {
-		if (gives_check(board, curr, piece->color)) {
-			// Remove move by making the previous move
-			// point to the next of the current
-			if (prev == NULL) {
-				*head = curr->next_sibling;
-			} else {
-				prev->next_sibling = curr->next_sibling;
+	// Without legality info, remove the moves that put the king in check
+	// by trying them. Otherwise illegal moves were never generated.
+	int iter;
+	int kept = start;
+	for (iter = start; iter < list->count; iter++) {
+		uint32_t code = list->moves[iter];
+		if (legal == NULL) {
+			Move move;
+			Move_decode(code, &move);
+			if (gives_check(board, &move, piece->color)) {
+				continue;
 			}
-			count--;
-		} else {
-			// Remember which ones put opponent in check
-			if (!only_count && gives_check(board, curr, -piece->color)) {
-				curr->gives_check = true;
-			}
-			prev = curr;
 		}
-		curr = curr->next_sibling;
-		iter++;
+		// Remember which ones put opponent in check
+		if (move_gives_check(board, legal, code, piece->shape, piece->color)) {
+			code |= MOVE_GIVES_CHECK;
+		}
+		list->moves[kept++] = code;
 	}
-	return count;
+	list->count = kept;
+	return kept - start;
 }
 
 
-static void add_move(Move **head, Move *move) {
-	// Case 1: not adding moves, just counting.
-	if (head == NULL) {
-		return;
-	// Case 2: List is empty. Insert move as first item.
-	} else if (Move_is_nullmove(*head)) {
+static void prepend_move(Move **head, Move *move) {
+	// Case 1: List is empty. Insert move as first item.
+	if (Move_is_nullmove(*head)) {
 		Move_destroy(*head);
 		*head = move;
-	// Case 3: insert move *before* head
+	// Case 2: insert move *before* head
 	} else {
 		move->next_sibling = *head;
 		*head = move;
@@ -356,51 +459,82 @@ static void add_move(Move **head, Move *move) {
 }
 
 
-static void add_move_pawn(Move **head, int color, int x, int y, int xx, int yy) {
-	if (head == NULL) {
-		return;
-	} else if (yy == 7 || yy == 0) {
-		add_move(head, Move_create(color, x, y, xx, yy, QUEEN));
-		add_move(head, Move_create(color, x, y, xx, yy, KNIGHT));
-	} else {
-		add_move(head, Move_create(color, x, y, xx, yy, 0));
+static void add_move(MoveList *list, int from, int to, int promotion) {
+	// When just counting, there is no list
+	if (list != NULL) {
+		assert(list->count < MAX_MOVES);
+		MoveList_add(list, MOVE_CODE(from, to, promotion));
 	}
 }
 
 
-static int get_valid_moves_pawn(Move **head, Board *board, int x, int y, int color, bool only_count) {
-	int xx, yy;
-	int startY = color == WHITE ? 6 : 1;
+static int add_moves(MoveList *list, int from, Bitboard targets) {
+	if (list == NULL) {
+		return Bitboard_count(targets);
+	}
 	int count = 0;
-	if (Board_get_piece(board, x, y - color) == NULL) {
-		if(!only_count) add_move_pawn(head, color, x, y, x, y - color);
+	while (targets) {
+		add_move(list, from, Bitboard_pop(&targets), 0);
 		count++;
-		if (y == startY && Board_get_piece(board, x, y - 2*color) == NULL) {
-			if(!only_count) add_move(head, Move_create(color, x, y, x, y - 2*color, 0));
+	}
+	return count;
+}
+
+
+static int add_move_pawn(MoveList *list, int from, int to) {
+	if (SQUARE_Y(to) == 7 || SQUARE_Y(to) == 0) {
+		add_move(list, from, to, QUEEN);
+		add_move(list, from, to, KNIGHT);
+		return 2;
+	}
+	add_move(list, from, to, 0);
+	return 1;
+}
+
+
+static int get_valid_moves_pawn(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind) {
+	int startY = color == WHITE ? 6 : 1;
+	int count = 0;
+	int yy = y - color;
+	// Only on hand-made boards can a pawn stand on the last rank
+	if (yy < 0 || yy > 7) {
+		return 0;
+	}
+	int from = SQUARE(x, y);
+	Bitboard allowed = legal_targets(legal, from);
+	// Pushes, of which only promotions count as captures
+	bool promotion = (yy == 0 || yy == 7);
+	bool pushes = promotion ? kind != GENERATE_QUIETS : kind != GENERATE_CAPTURES;
+	if (Board_is_empty(board, x, yy) && pushes) {
+		if (allowed & SQUARE_BIT(x, yy)) {
+			count += add_move_pawn(list, from, SQUARE(x, yy));
+		}
+		if (y == startY && kind != GENERATE_CAPTURES
+				&& Board_is_empty(board, x, y - 2*color) && (allowed & SQUARE_BIT(x, y - 2*color))) {
+			add_move(list, from, SQUARE(x, y - 2*color), 0);
 			count++;
 		}
 	}
-	xx = x-1; yy = y - color;
-	if (x > 0 && Board_is_color(board, xx, yy, -color)) {
-		if(!only_count) add_move_pawn(head, color, x, y, xx, yy);
-		count++;
+	if (kind == GENERATE_QUIETS) {
+		return count;
 	}
-	xx = x+1; yy = y - color;
-	if (x < 7 && Board_is_color(board, xx, yy, -color)) {
-		if(!only_count) add_move_pawn(head, color, x, y, xx, yy);
-		count++;
+	Bitboard captures = Bitboard_pawn_attacks(color, from) & board->occupied[COLOR_INDEX(-color)] & allowed;
+	while (captures) {
+		count += add_move_pawn(list, from, Bitboard_pop(&captures));
 	}
 	// En passant)
 	if (color == WHITE) {
 		if (board->white_can_en_passant >= 0 && y == RANK_5 &&
-				(x == board->white_can_en_passant - 1 || x == board->white_can_en_passant + 1)) {
-			if(!only_count) add_move(head, Move_create(color, x, y, board->white_can_en_passant, y - 1, 0));
+				(x == board->white_can_en_passant - 1 || x == board->white_can_en_passant + 1)
+				&& en_passant_is_legal(board, legal, x, y, board->white_can_en_passant, color)) {
+			add_move(list, from, SQUARE(board->white_can_en_passant, y - 1), 0);
 			count++;
 		}
 	} else {
 		if (board->black_can_en_passant >= 0 && y == RANK_4 &&
-				(x == board->black_can_en_passant - 1 || x == board->black_can_en_passant + 1)) {
-			if(!only_count) add_move(head, Move_create(color, x, y, board->black_can_en_passant, y+1, 0));
+				(x == board->black_can_en_passant - 1 || x == board->black_can_en_passant + 1)
+				&& en_passant_is_legal(board, legal, x, y, board->black_can_en_passant, color)) {
+			add_move(list, from, SQUARE(board->black_can_en_passant, y + 1), 0);
 			count++;
 		}
 	}
@@ -408,242 +542,84 @@ static int get_valid_moves_pawn(Move **head, Board *board, int x, int y, int col
 }
 
 
-static int get_valid_moves_knight(Move **head, Board *board, int x, int y, int color, bool only_count) {
-	int xx, yy;
-	int count = 0;
-	if (x > 0) {
-		xx = x-1; yy = y-2;
-		if (y > 1 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-			if(!only_count) add_move(head, Move_create(color, x, y, xx, yy, 0));
-			count++;
-		}
-		xx = x-1; yy = y+2;
-		if (y < 6 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-			if(!only_count) add_move(head, Move_create(color, x, y, xx, yy, 0));
-			count++;
-		}
-		if (x > 1) {
-			xx = x-2; yy = y-1;
-			if (y > 0 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-				if(!only_count) add_move(head, Move_create(color, x, y, xx, yy, 0));
-				count++;
-			}
-			xx = x-2; yy = y+1;
-			if (y < 7 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-				if(!only_count) add_move(head, Move_create(color, x, y, xx, yy, 0));
-				count++;
-			}
-		}
-	}
-	if (x < 7) {
-		xx = x+1; yy = y-2;
-		if (y > 1 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-			if(!only_count) add_move(head, Move_create(color, x, y,xx, yy, 0));
-			count++;
-		}
-		xx = x+1; yy = y+2;
-		if (y < 6 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-			if(!only_count) add_move(head, Move_create(color, x, y,xx, yy, 0));
-			count++;
-		}
-		if (x < 6) {
-			xx = x+2; yy = y-1;
-			if (y>0 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-				if(!only_count) add_move(head, Move_create(color, x, y,xx, yy, 0));
-				count++;
-			}
-			xx = x+2; yy = y+1;
-			if (y<7 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-				if(!only_count) add_move(head, Move_create(color, x, y,xx, yy, 0));
-				count++;
-			}
-		}
-	}
-	return count;
+static int get_valid_moves_knight(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind) {
+	Bitboard targets = Bitboard_knight_attacks(SQUARE(x, y)) & ~board->occupied[COLOR_INDEX(color)]
+		& legal_targets(legal, SQUARE(x, y)) & kind_targets(board, color, kind);
+	return add_moves(list, SQUARE(x, y), targets);
 }
 		
 
-static int get_valid_moves_rook(Move **head, Board *board, int x, int y, int color, bool only_count) {
-	int i, j;
-	int count = 0;
-	i = x-1; // Left
-	while (i >= 0 && (Board_get_piece(board, i, y) == NULL || Board_get_piece(board, i, y)->color != color)) {
-		if(!only_count) add_move(head, Move_create(color, x, y, i, y, 0));
-		count++;
-		if (Board_get_piece(board, i, y) != NULL)
-			break;
-		i = i - 1;
-	}
-	i = x + 1; // right
-	while (i <= 7 && (Board_get_piece(board, i, y) == NULL || Board_get_piece(board, i, y)->color != color)) {
-		if(!only_count) add_move(head, Move_create(color, x, y, i, y, 0));
-		count++;
-		if (Board_get_piece(board, i, y) != NULL)
-			break;
-		i = i + 1;
-	}
-	j = y - 1; // top
-	while (j >= 0 && (Board_get_piece(board, x, j) == NULL || Board_get_piece(board, x, j)->color != color)) {
-		if(!only_count) add_move(head, Move_create(color, x, y, x, j, 0));
-		count++;
-		if (Board_get_piece(board, x, j) != NULL)
-			break;
-		j = j - 1;
-	}		
-	j = y + 1; // bottom
-	while (j <= 7 && (Board_get_piece(board, x, j) == NULL || Board_get_piece(board, x, j)->color != color)) {
-		if(!only_count) add_move(head, Move_create(color, x, y, x, j, 0));
-		count++;
-		if (Board_get_piece(board, x, j) != NULL)
-			break;
-		j = j + 1;
-	}
-	return count;
+static int get_valid_moves_rook(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind) {
+	Bitboard targets = Bitboard_rook_attacks(SQUARE(x, y), board->occupancy) & ~board->occupied[COLOR_INDEX(color)]
+		& legal_targets(legal, SQUARE(x, y)) & kind_targets(board, color, kind);
+	return add_moves(list, SQUARE(x, y), targets);
 }
 
-static int get_valid_moves_bishop(Move **head, Board *board, int x, int y, int color, bool only_count) {
-	int i, j;
-	int count = 0;
-	i = x - 1;
-	j = y - 1;
-	while (i >= 0 && j >= 0 && (Board_get_piece(board, i, j) == NULL || Board_get_piece(board, i, j)->color != color)) {
-		if(!only_count) add_move(head, Move_create(color, x, y, i, j, 0));
-		count++;
-		if (Board_get_piece(board, i, j) != NULL)
-			break;
-		i = i - 1;
-		j = j - 1;
-	}
-	i = x - 1;
-	j = y + 1;
-	while (i >= 0 && j <= 7 && (Board_get_piece(board, i, j) == NULL || Board_get_piece(board, i, j)->color != color)) {
-		if(!only_count) add_move(head, Move_create(color, x, y, i, j, 0));
-		count++;
-		if (Board_get_piece(board, i, j) != NULL)
-			break;
-		i = i - 1;
-		j = j + 1;
-	}
-	i = x + 1;
-	j = y - 1;
-	while (i <= 7 && j >= 0 && (Board_get_piece(board, i, j) == NULL || Board_get_piece(board, i, j)->color != color)) {
-		if(!only_count) add_move(head, Move_create(color, x, y, i, j, 0));
-		count++;
-		if (Board_get_piece(board, i, j) != NULL)
-			break;
-		i = i + 1;
-		j = j - 1;
-	}
-	i = x + 1;
-	j = y + 1;
-	while (i <= 7 && j <= 7 && (Board_get_piece(board, i, j) == NULL || Board_get_piece(board, i, j)->color != color)) {
-		if(!only_count) add_move(head, Move_create(color, x, y, i, j, 0));
-		count++;
-		if (Board_get_piece(board, i, j) != NULL)
-			break;
-		i = i + 1;
-		j = j + 1;
-	}
-	return count;
+static int get_valid_moves_bishop(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind) {
+	Bitboard targets = Bitboard_bishop_attacks(SQUARE(x, y), board->occupancy) & ~board->occupied[COLOR_INDEX(color)]
+		& legal_targets(legal, SQUARE(x, y)) & kind_targets(board, color, kind);
+	return add_moves(list, SQUARE(x, y), targets);
 }
 
 
-static int get_valid_moves_queen(Move **head, Board *board, int x, int y, int color, bool only_count) {
-	int count;
-	count = get_valid_moves_rook(head, board, x, y, color, only_count);
-	count += get_valid_moves_bishop(head, board, x, y, color, only_count);
-	return count;
+static int get_valid_moves_queen(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind) {
+	Bitboard targets = Bitboard_queen_attacks(SQUARE(x, y), board->occupancy) & ~board->occupied[COLOR_INDEX(color)]
+		& legal_targets(legal, SQUARE(x, y)) & kind_targets(board, color, kind);
+	return add_moves(list, SQUARE(x, y), targets);
 }
 
 
-static int get_valid_moves_king(Move **head, Board *board, int x, int y, int color, bool only_count) {
-	int xx, yy;
-	int count = 0;
-	if (x >= 1) {
-		xx = x-1; yy = y;
-		if (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color) {
-			if(!only_count) add_move(head, Move_create(color, x, y,  xx, yy, 0));
-			count++;
-		}
-		xx = x-1; yy = y-1;
-		if (y >= 1 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-			if(!only_count) add_move(head, Move_create(color, x, y,  xx, yy, 0));
-			count++;
-		}
-		xx = x-1; yy = y+1;
-		if (y<=6 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-			if(!only_count) add_move(head, Move_create(color, x, y,  xx, yy, 0));
-			count++;
-		}
-	}
-	if (x <= 6) {
-		xx = x+1; yy = y;
-		if (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color) {
-			if(!only_count) add_move(head, Move_create(color, x, y,  xx, yy, 0));
-			count++;
-		}
-		xx = x+1; yy = y-1;
-		if (y >= 1 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-			if(!only_count) add_move(head, Move_create(color, x, y,  xx, yy, 0));
-			count++;
-		}
-		xx = x+1; yy = y+1;
-		if (y<=6 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-			if(!only_count) add_move(head, Move_create(color, x, y,  xx, yy, 0));
-			count++;
-		}
-	}
-	xx = x; yy = y-1;
-	if (y >= 1 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-		if(!only_count) add_move(head, Move_create(color, x, y,  xx, yy, 0));
-		count++;
+static int get_valid_moves_king(MoveList *list, Board *board, int x, int y, int color, Legality *legal, int kind) {
+	int from = SQUARE(x, y);
+	Bitboard targets = Bitboard_king_attacks(from) & ~board->occupied[COLOR_INDEX(color)]
+		& kind_targets(board, color, kind);
+	if (legal != NULL) {
+		targets &= legal->king_targets;
 	}
-	xx = x; yy = y+1;
-	if (y <= 6 && (Board_get_piece(board, xx, yy) == NULL || Board_get_piece(board, xx, yy)->color != color)) {
-		if(!only_count) add_move(head, Move_create(color, x, y,  xx, yy, 0));
-		count++;
+	int count = add_moves(list, from, targets);
+	// Castling is neither a capture nor allowed at check
+	if (kind == GENERATE_CAPTURES || kind == GENERATE_EVASIONS) {
+		return count;
 	}
 	// Castling)
 	if (color == BLACK && y == 0 && x == 4 && !v_square_gives_check(board, 4, 0, color)) {
 		if (board->black_can_castle_queens_side
 				&& Board_is_at(board, 0, 0, ROOK, color)
-				&& Board_get_piece(board, 1, 0) == NULL
-				&& Board_get_piece(board, 2, 0) == NULL
-				&& Board_get_piece(board, 3, 0) == NULL
-				&& !v_square_gives_check(board, 1, 0, BLACK)
+				&& Board_is_empty(board, 1, 0)
+				&& Board_is_empty(board, 2, 0)
+				&& Board_is_empty(board, 3, 0)
 				&& !v_square_gives_check(board, 2, 0, BLACK)
 				&& !v_square_gives_check(board, 3, 0, BLACK)) {
-				if(!only_count) add_move(head, Move_create(color, x, y, x-2, y, 0));
+			add_move(list, from, SQUARE(x-2, y), 0);
 			count++;
 		}
 		if (board->black_can_castle_kings_side
 				&& Board_is_at(board, 7, 0, ROOK, color)
-				&& Board_get_piece(board, 5, 0) == NULL
-				&& Board_get_piece(board, 6, 0) == NULL
+				&& Board_is_empty(board, 5, 0)
+				&& Board_is_empty(board, 6, 0)
 				&& !v_square_gives_check(board, 5, 0, BLACK)
 				&& !v_square_gives_check(board, 6, 0, BLACK)) {
-			if(!only_count) add_move(head, Move_create(color, x, y, x+2, y, 0));
+			add_move(list, from, SQUARE(x+2, y), 0);
 			count++;
 		}
 	} else if (color == WHITE && y == 7 && x == 4 && !v_square_gives_check(board, 4, 7, color)) {
 		if (board->white_can_castle_queens_side
 				&& Board_is_at(board, 0, 7, ROOK, color)
-				&& Board_get_piece(board, 1, 7) == NULL
-				&& Board_get_piece(board, 2, 7) == NULL
-				&& Board_get_piece(board, 3, 7) == NULL
-				&& !v_square_gives_check(board, 1, 7, WHITE)
+				&& Board_is_empty(board, 1, 7)
+				&& Board_is_empty(board, 2, 7)
+				&& Board_is_empty(board, 3, 7)
 				&& !v_square_gives_check(board, 2, 7, WHITE)
 				&& !v_square_gives_check(board, 3, 7, WHITE)) {
-			if(!only_count) add_move(head, Move_create(color, x, y, x-2, y, 0));
+			add_move(list, from, SQUARE(x-2, y), 0);
 			count++;
 		}
 		if (board->white_can_castle_kings_side
 				&& Board_is_at(board, 7, 7, ROOK, color)
-				&& Board_get_piece(board, 5, 7) == NULL
-				&& Board_get_piece(board, 6, 7) == NULL
+				&& Board_is_empty(board, 5, 7)
+				&& Board_is_empty(board, 6, 7)
 				&& !v_square_gives_check(board, 5, 7, WHITE)
 				&& !v_square_gives_check(board, 6, 7, WHITE)) {
-			if(!only_count) add_move(head, Move_create(color, x, y, x+2, y, 0));
+			add_move(list, from, SQUARE(x+2, y), 0);
 			count++;
 		}
 	}
@@ -668,191 +644,44 @@ static void add_square(Square **head, Square *square) {
 }
 
 
+bool v_is_capture(Board *board, uint32_t code) {
+	int from = MOVE_FROM(code);
+	int to = MOVE_TO(code);
+	if ((board->occupancy & (1ULL << to)) || MOVE_PROMOTION(code)) {
+		return true;
+	}
+	// En passant
+	Bitboard pawns = board->pieces[COLOR_INDEX(WHITE)][PAWN] | board->pieces[COLOR_INDEX(BLACK)][PAWN];
+	return (pawns & (1ULL << from)) && SQUARE_X(from) != SQUARE_X(to);
+}
+
+
+Bitboard v_attackers_to(Board *board, int sq, Bitboard occupancy) {
+	Bitboard *white = board->pieces[COLOR_INDEX(WHITE)];
+	Bitboard *black = board->pieces[COLOR_INDEX(BLACK)];
+	return (Bitboard_pawn_attacks(BLACK, sq) & white[PAWN])
+		| (Bitboard_pawn_attacks(WHITE, sq) & black[PAWN])
+		| (Bitboard_knight_attacks(sq) & (white[KNIGHT] | black[KNIGHT]))
+		| (Bitboard_rook_attacks(sq, occupancy)
+			& (white[ROOK] | black[ROOK] | white[QUEEN] | black[QUEEN]))
+		| (Bitboard_bishop_attacks(sq, occupancy)
+			& (white[BISHOP] | black[BISHOP] | white[QUEEN] | black[QUEEN]))
+		| (Bitboard_king_attacks(sq) & (white[KING] | black[KING]));
+}
+
+
 int v_square_attacked_by(Square **head, Board *board, int x, int y, int color, int shape) {
+	// A pawn only attacks a square it can capture on
+	if (shape == PAWN && Board_is_empty(board, x, y)) {
+		return 0;
+	}
+	Bitboard attackers = v_attackers_to(board, SQUARE(x, y), board->occupancy)
+		& board->pieces[COLOR_INDEX(-color)][shape];
 	int count = 0;
-	if(shape == PAWN && !Board_is_empty(board, x, y)) {
-		// Pawns
-		if(Board_is_at_safe(board, x - 1, y - color, PAWN, -color)) {
-			add_square(head, Square_create(x - 1, y - color, board));
-			count++;
-		}
-		if(Board_is_at_safe(board, x + 1, y - color, PAWN, -color)) {
-			add_square(head, Square_create(x + 1, y - color, board));
-			count++;
-		}
-	} else if(shape == KNIGHT) {
-		// Knights
-		if(Board_is_at_safe(board, x - 1, y - 2, KNIGHT, -color)) {
-			add_square(head, Square_create(x - 1, y- 2, board));
-			count++;
-		}
-		if(Board_is_at_safe(board, x + 1, y - 2, KNIGHT, -color)) {
-			add_square(head, Square_create(x + 1, y- 2, board));
-			count++;
-		}
-		if(Board_is_at_safe(board, x - 1, y + 2, KNIGHT, -color)) {
-			add_square(head, Square_create(x - 1, y+ 2, board));
-			count++;
-		}
-		if(Board_is_at_safe(board, x + 1, y + 2, KNIGHT, -color)) {
-			add_square(head, Square_create(x + 1, y + 2, board));
-			count++;
-		}
-		if(Board_is_at_safe(board, x - 2, y - 1, KNIGHT, -color)) {
-			add_square(head, Square_create(x - 2, y - 1, board));
-			count++;
-		}
-		if(Board_is_at_safe(board, x + 2, y - 1, KNIGHT, -color)) {
-			add_square(head, Square_create(x + 2, y - 1, board));
-			count++;
-		}
-		if(Board_is_at_safe(board, x - 2, y + 1, KNIGHT, -color)) {
-			add_square(head, Square_create(x - 2, y + 1, board));
-			count++;
-		}
-		if(Board_is_at_safe(board, x + 2, y + 1, KNIGHT, -color)) {
-			add_square(head, Square_create(x + 2, y + 1, board));
-			count++;
-		}
-	} else if(shape == ROOK || shape == QUEEN) {
-		// Rook and Queen
-		int i = x-1;
-		while(i >= 0) {
-			if(Board_is_at(board, i, y, shape, -color)) {
-				add_square(head, Square_create(i, y, board));
-				count++;
-				break;
-			}
-			if(!Board_is_empty(board, i, y)) {
-				break;
-			}
-			i--;
-		}
-		i = x + 1;
-		while(i <= 7) {
-			if(Board_is_at(board, i, y, shape, -color)) {
-				add_square(head, Square_create(i, y, board));
-				count++;
-				break;
-			}
-			if(!Board_is_empty(board, i, y)) {
-				break;
-			}
-			i++;
-		}
-		i = y - 1;
-		while(i >= 0) {
-			if(Board_is_at(board, x, i, shape, -color)) {
-				add_square(head, Square_create(x, i, board));
-				count++;
-				break;
-			}
-			if(!Board_is_empty(board, x, i)) {
-				break;
-			}
-			i--;
-		}
-		i = y + 1;
-		while(i <= 7) {
-			if(Board_is_at(board, x, i, shape, -color)) {
-				add_square(head, Square_create(x, i, board));
-				count++;
-				break;
-			}
-			if(!Board_is_empty(board, x, i)) {
-				break;
-			}
-			i++;
-		}
-	} else if(shape == BISHOP || shape == QUEEN) {
-		// Bishop and Queen
-		int i, j;
-		i = x - 1; j = y - 1;
-		while(i >= 0 && j >= 0) {
-			if(Board_is_at(board, i, j, shape, -color)) {
-				add_square(head, Square_create(i, j, board));
-				count++;
-				break;
-			}
-			if(!Board_is_empty(board, i, j)) {
-				break;
-			}
-			i--; j--;
-		}
-		i = x - 1; j = y + 1;
-		while(i >= 0 && j <= 7) {
-			if(Board_is_at(board, i, j, shape, -color)) {
-				add_square(head, Square_create(i, j, board));
-				count++;
-				break;
-			}
-			if(!Board_is_empty(board, i, j)) {
-				break;
-			}
-			i--; j++;
-		}
-		i = x + 1; j = y - 1;
-		while(i <= 7 && j >= 0) {
-			if(Board_is_at(board, i, j, shape, -color)) {
-				add_square(head, Square_create(i, j, board));
-				count++;
-				break;
-			}
-			if(!Board_is_empty(board, i, j)) {
-				break;
-			}
-			i++; j--;
-		}
-		i = x + 1; j = y + 1;
-		while(i <= 7 && j <= 7) {
-			if(Board_is_at(board, i, j, shape, -color)) {
-				add_square(head, Square_create(i, j, board));
-				count++;
-				break;
-			}
-			if(!Board_is_empty(board, i, j)) {
-				break;
-			}
-			i++; j++;
-		}
-	} else if(shape == KING) {
-		// King
-		if(x > 0) {
-			if(Board_is_at(board, x - 1, y, KING, -color)) {
-				add_square(head, Square_create(x - 1, y, board));
-				count++;
-			}
-			if(y>0 && Board_is_at(board, x - 1, y - 1, KING, -color)) {
-				add_square(head, Square_create(x - 1, y - 1, board));
-				count++;
-			}
-			if(y<7 && Board_is_at(board, x - 1, y + 1, KING, -color)) {
-				add_square(head, Square_create(x - 1, y + 1, board));
-				count++;
-			}
-		}
-		if(x < 7) {
-			if(Board_is_at(board, x + 1, y, KING, -color)) {
-				add_square(head, Square_create(x + 1, y, board));
-				count++;
-			}
-			if(y>0 && Board_is_at(board, x + 1, y - 1, KING, -color)) {
-				add_square(head, Square_create(x + 1, y- 1, board));
-				count++;
-			}
-			if(y<7 && Board_is_at(board, x + 1, y + 1, KING, -color)) {
-				add_square(head, Square_create(x + 1, y + 1, board));
-				count++;
-			}
-		}
-		if(y > 0 && Board_is_at(board, x , y - 1 , KING, -color)) {
-			add_square(head, Square_create(x, y - 1, board));
-			count++;
-		}
-		if(y < 7 && Board_is_at(board, x , y + 1 , KING, -color)) {
-			add_square(head, Square_create(x, y + 1, board));
-			count++;
-		}
+	while (attackers) {
+		int sq = Bitboard_pop(&attackers);
+		add_square(head, Square_create(SQUARE_X(sq), SQUARE_Y(sq), board));
+		count++;
 	}
 	return count;
-}
\ No newline at end of file
+}
@@ -19,9 +19,51 @@
 
 bool v_is_valid_move(Board *board, Move *move);
 
+/**
+ * Fills the list with all valid moves for the given color,
+ * and returns the number of moves. Doesn't allocate anything,
+ * so this is the one to use while searching.
+ */
+int v_get_moves(MoveList *list, Board *board, int color);
+
+/**
+ * Like v_get_moves, but only generates the captures, including
+ * en passant, and the promotions. For the quiescence search.
+ */
+int v_get_captures(MoveList *list, Board *board, int color);
+
+/**
+ * Like v_get_moves, but only generates the moves that v_get_captures
+ * leaves out: moves to empty squares that aren't promotions, and castling.
+ * Together, v_get_captures and v_get_quiets give all valid moves.
+ */
+int v_get_quiets(MoveList *list, Board *board, int color);
+
+/**
+ * Like v_get_moves, but for a player that is at check: skips the pieces
+ * and moves that can never get out of check. Gives the same moves as
+ * v_get_moves, faster, but only when the player is at check.
+ */
+int v_get_evasions(MoveList *list, Board *board, int color);
+
+/**
+ * Looks up a move, compared by MOVE_ID, among the valid moves of the piece
+ * it moves. Returns the move like v_get_moves would give it, or 0 if it isn't
+ * valid, e.g. a move that was remembered from another position. Much faster
+ * than generating all moves.
+ */
+uint32_t v_find_move(Board *board, int color, uint32_t move);
+
+/**
+ * Returns true if the move captures a piece (en passant included),
+ * or promotes. These are the moves of v_get_captures.
+ */
+bool v_is_capture(Board *board, uint32_t code);
+
 /**
  * Returns the number of valid moves, and puts the first
- * of those moves in the first parameter.
+ * of those moves in the first parameter. Like v_get_moves,
+ * but allocates a Move for each, so only use it outside the search.
  *
  * The first parameter must be allocated like so:
  * Move *head = Move_alloc();
@@ -47,6 +89,16 @@ int v_get_rough_move_count_for_piece(Board *board, int x, int y);
  */
 bool v_square_gives_check(Board *board, int x, int y, int color);
 
+/**
+ * Returns the pieces of both colors that attack the given square,
+ * with the sliding pieces blocked by `occupancy` instead of the pieces
+ * on the board. Removing pieces from `occupancy` uncovers the pieces
+ * behind them, which is how the static exchange evaluation finds
+ * x-ray attackers. Pieces that are not in `occupancy` are still
+ * returned, and pins are ignored.
+ */
+Bitboard v_attackers_to(Board *board, int sq, Bitboard occupancy);
+
 /**
  * Returns a list of attacking pieces that attack the given square.
  * Used by algebraicnotation.c to check if a certain move notation
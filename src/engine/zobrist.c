@@ -0,0 +1,86 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "bitboard.h"
+#include "board.h"
+#include "common.h"
+#include "datatypes.h"
+#include "zobrist.h"
+
+uint64_t ZOBRIST_PIECES[13][64];
+uint64_t ZOBRIST_BLACK_TO_MOVE;
+
+/// White king side, white queen side, black king side, black queen side
+static uint64_t ZOBRIST_CASTLING[4];
+/// Keys of the files on which en passant is possible
+static uint64_t ZOBRIST_EN_PASSANT[8];
+
+/**
+ * Returns the next number of a xorshift64* random generator.
+ */
+static uint64_t next_random(uint64_t *state);
+
+extern inline uint64_t Zobrist_piece(uint8_t code, int sq);
+
+void Zobrist_init() {
+	// Fixed seed, so hashes don't change between runs
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+	int code, sq, i;
+	for (code = 1; code <= 12; code++) {
+		for (sq = 0; sq < 64; sq++) {
+			ZOBRIST_PIECES[code][sq] = next_random(&state);
+		}
+	}
+	ZOBRIST_BLACK_TO_MOVE = next_random(&state);
+	for (i = 0; i < 4; i++) {
+		ZOBRIST_CASTLING[i] = next_random(&state);
+	}
+	for (i = 0; i < 8; i++) {
+		ZOBRIST_EN_PASSANT[i] = next_random(&state);
+	}
+}
+
+uint64_t Zobrist_state(Board *b) {
+	uint64_t key = 0;
+	if (b->white_can_castle_kings_side) {
+		key ^= ZOBRIST_CASTLING[0];
+	}
+	if (b->white_can_castle_queens_side) {
+		key ^= ZOBRIST_CASTLING[1];
+	}
+	if (b->black_can_castle_kings_side) {
+		key ^= ZOBRIST_CASTLING[2];
+	}
+	if (b->black_can_castle_queens_side) {
+		key ^= ZOBRIST_CASTLING[3];
+	}
+	// 255 (i.e. -1) means no en passant
+	if (b->white_can_en_passant < 8) {
+		key ^= ZOBRIST_EN_PASSANT[b->white_can_en_passant];
+	}
+	if (b->black_can_en_passant < 8) {
+		key ^= ZOBRIST_EN_PASSANT[b->black_can_en_passant];
+	}
+	return key;
+}
+
+uint64_t Zobrist_hash(Board *b) {
+	uint64_t key = Zobrist_state(b);
+	int x, y;
+	for (x = 0; x < 8; x++) {
+		for (y = 0; y < 8; y++) {
+			key ^= Zobrist_piece(b->fields[x][y], SQUARE(x, y));
+		}
+	}
+	if (Board_turn(b) == BLACK) {
+		key ^= ZOBRIST_BLACK_TO_MOVE;
+	}
+	return key;
+}
+
+static uint64_t next_random(uint64_t *state) {
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 0x2545F4914F6CDD1DULL;
+}
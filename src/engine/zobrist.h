@@ -0,0 +1,50 @@
+#include <stdint.h>
+#include "datatypes.h"
+
+/**
+ * zobrist.h / zobrist.c
+ *
+ * Zobrist hashing: every piece on every square, the side to move,
+ * each castling right and each en passant file has a random 64-bit key.
+ * The hash of a position is the XOR of the keys of everything in it,
+ * so a move can update the hash by XOR-ing a few keys in and out.
+ *
+ * Board.hash is kept up to date by Board_set, Board_make_move and
+ * Board_undo_move. Zobrist_hash computes it from scratch, which is
+ * only needed after changing a board in another way (e.g. reading it).
+ * Call Zobrist_init once at startup, before creating any boards.
+ *
+ */
+#ifndef _ZOBRIST_H_
+#define _ZOBRIST_H_
+
+/// Keys, filled by Zobrist_init. Indexed by piece code (see piece.h) and square,
+/// the row of code 0 (empty) is all zeroes.
+extern uint64_t ZOBRIST_PIECES[13][64];
+/// XOR-ed in when black is to move
+extern uint64_t ZOBRIST_BLACK_TO_MOVE;
+
+/**
+ * Fills the tables with random keys. The keys are the same
+ * on every run, so hashes can be compared across runs.
+ */
+void Zobrist_init();
+
+/**
+ * Returns the key of a piece code on a square.
+ */
+inline uint64_t Zobrist_piece(uint8_t code, int sq) {
+	return ZOBRIST_PIECES[code][sq];
+}
+
+/**
+ * Returns the combined key of the castling rights and en passant files of a board.
+ */
+uint64_t Zobrist_state(Board *b);
+
+/**
+ * Computes the hash of a board from scratch.
+ */
+uint64_t Zobrist_hash(Board *b);
+
+#endif
@@ -0,0 +1 @@
+const char *GIT_VERSION = "1674649";
@@ -5,10 +5,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include "gitversion.h"
 #include "main.h"
 #include "tests.h"
 #include "engine/algebraicnotation.h"
+#include "engine/bitboard.h"
 #include "engine/board.h"
 #include "engine/common.h"
 #include "engine/datatypes.h"
@@ -18,7 +20,9 @@
 #include "engine/piece.h"
 #include "engine/simplenotation.h"
 #include "engine/stats.h"
+#include "engine/transposition.h"
 #include "engine/validator.h"
+#include "engine/zobrist.h"
 #ifdef UNICODE_FIX
 #include <windows.h>
 #endif
@@ -45,6 +49,12 @@ static int no_counter = 0;
 // Using the -m command, this toggles between shorthand (algebraic)
 // and simple move notation.
 static bool algebraic = true;
+// Number of search threads and the way they work together,
+// set with the -t and -mode options.
+static int threads = DEFAULT_THREADS;
+static int parallel_mode = PARALLEL_ROOT_SPLIT;
+// Size of the transposition table in megabytes, set with the -hash option.
+static int hash_mb = TRANSPOSITION_TABLE_MB;
 
 
 // Prepares the Windows Command Prompt to show unicode characters
@@ -68,6 +78,19 @@ int main(int argc, char *argv[]) {
 	#endif
 	// Prepare filenames:
 	prepare_filenames();
+	// Prepare the attack tables of the move generator:
+	Bitboard_init();
+	// Prepare the keys for hashing positions:
+	Zobrist_init();
+	// Engine options come first, and are taken off the arguments
+	int used;
+	while (argc >= 2 && (used = parse_engine_option(argv[1], argc >= 3 ? argv[2] : NULL)) > 0) {
+		argv += used;
+		argc -= used;
+	}
+	Engine_set_threads(threads, parallel_mode);
+	// Remembers positions the engine has already searched:
+	Transposition_init(hash_mb);
 
 	// Only few arguments are allowed:
 	if (argc < 2 || argc > 3) {
@@ -135,8 +158,20 @@ int main(int argc, char *argv[]) {
 		// Run tests
 		return !test_moves()
 			|| !test_validator()
+			|| !test_perft()
+			|| !test_generators()
+			|| !test_picker()
+			|| !test_heuristics()
+			|| !test_see()
+			|| !test_zobrist()
+			|| !test_transposition()
 			|| !test_serializer("test.chess")
 			|| !test_engine()
+			|| !test_time_limit()
+			|| !test_threads()
+			|| !test_variation()
+			|| !test_multi_pv()
+			|| !test_quiescence()
 			|| !test_evaluation();
 	} else if (strcmp("testeval", argv[index]) == 0) {
 		// Run visual test
@@ -187,6 +222,17 @@ int main(int argc, char *argv[]) {
 	} else if (strcmp("-e", argv[index]) == 0 || strcmp("evaluate", argv[index]) == 0) {
 		// Print board position value.
 		evaluate(verbosity);
+	} else if (strcmp("analyze", argv[index]) == 0) {
+		// Print the best moves, with the lines that follow them.
+		int lines = ANALYSIS_LINES;
+		if (index + 1 < argc) {
+			lines = atoi(argv[index+1]);
+			if (lines < 1) {
+				fprintf(stderr, "Invalid number of moves to show. Please retry and\nspecify a number of 1 or more.\n");
+				return 1;
+			}
+		}
+		analyze(lines);
 	} else if (strcmp("list", argv[index]) == 0) {
 		// Print a list of available moves:
 		show_moves(false);
@@ -243,9 +289,11 @@ int main(int argc, char *argv[]) {
 				// Think of a counter move...
 				Move *counter;
 				Stats stats = {0, 0, 0};
-				counter = Engine_turn(board, &stats, Board_turn(board), MAX_PLY_DEPTH, verbosity);
-				// Show counter move
+				Variation pv;
+				counter = Engine_turn(board, &stats, Board_turn(board), MAX_PLY_DEPTH, verbosity, &pv);
+				// Show counter move, and what the engine expects to follow
 				print_move(board, counter);
+				print_line(board, &pv);
 				// print_move and save_move both execute the formatter,
 				// but they use a different format so we can't optimize this code
 				save_move(board, counter);
@@ -294,7 +342,7 @@ void usage() {
 	//		 list			Shows the user's available moves.
 	//		evaluate 		Shows the board position evaluation of the current game.
 	
-	printf("\nusage:       chess [-s,-m,-x] <command>\n\n");
+	printf("\nusage:       chess [-t <n>] [-mode <mode>] [-hash <mb>] [-s,-m,-x] <command>\n\n");
 	printf("commands and options:\n");
 	printf(" <move>       Make a move in an ongoing game. The computer player will respond\n");
 	printf("              with a move. The move should be in a algebraic notation like so:\n");
@@ -312,16 +360,58 @@ void usage() {
 	printf("              <n>. Can be restored using the restore command.\n");
 	printf("  restore <n> Restores a backed-up game from the file with the given number\n");
 	printf("              <n>. Requires a <n>.game file to be present.\n");
+	printf("  analyze [n] Shows the n best moves (default %d) for the player whose turn\n", ANALYSIS_LINES);
+	printf("              it is, each with its evaluation and the moves expected to follow.\n");
 	printf("-s            Silences output to only critical messages, such as moves.\n");
 	printf("-m            Uses simple move notation. When used, moves must be written like\n");
 	printf("              so: 'd7-d5'. No indications for pieces, captures or check are\n");
 	printf("              used. For pawn promotions, append an extra capital letter:\n");
 	printf("              'e7-e4Q'. Automatically also enables silent mode, i.e.: -s.\n");
 	printf("-x            Performs the move without having the AI player do a counter move.\n");
+	printf("-t <n>        Searches with n threads, at most %d (default %d).\n", max_threads(), DEFAULT_THREADS);
+	printf("-mode <mode>  How the threads work together: 'split' divides the moves (the\n");
+	printf("              default), 'lazy' lets each search all moves, 'ybwc' shares the\n");
+	printf("              deeper parts of the search.\n");
+	printf("-hash <mb>    Size of the table of searched positions in megabytes (default %d).\n", TRANSPOSITION_TABLE_MB);
+	printf("              The engine options -t, -mode and -hash go before any other option.\n");
 	printf("-h --help     Shows this help message.\n");
 	printf("-v --version  Shows the application version.\n");
 }
 
+int max_threads() {
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores > DEFAULT_THREADS ? (int) cores : DEFAULT_THREADS;
+}
+
+int parse_engine_option(char *option, char *value) {
+	if (strcmp("-t", option) == 0) {
+		if (value == NULL || (threads = atoi(value)) < 1 || threads > max_threads()) {
+			fprintf(stderr, "Invalid number of threads. Please retry and\nspecify a number 1-%d.\n", max_threads());
+			exit(1);
+		}
+		return 2;
+	} else if (strcmp("-mode", option) == 0) {
+		if (value != NULL && strcmp("split", value) == 0) {
+			parallel_mode = PARALLEL_ROOT_SPLIT;
+		} else if (value != NULL && strcmp("lazy", value) == 0) {
+			parallel_mode = PARALLEL_LAZY_SMP;
+		} else if (value != NULL && strcmp("ybwc", value) == 0) {
+			parallel_mode = PARALLEL_YBWC;
+		} else {
+			fprintf(stderr, "Invalid mode. Please retry and\nspecify 'split', 'lazy' or 'ybwc'.\n");
+			exit(1);
+		}
+		return 2;
+	} else if (strcmp("-hash", option) == 0) {
+		if (value == NULL || (hash_mb = atoi(value)) < 1) {
+			fprintf(stderr, "Invalid table size. Please retry and\nspecify a number of megabytes of 1 or more.\n");
+			exit(1);
+		}
+		return 2;
+	}
+	return 0;
+}
+
 int has_game(int show_error) {
 	return file_exists(DEFAULT_FILE, show_error);
 }
@@ -384,9 +474,11 @@ void new_game(int user_color) {
 		// AI starts, so think of a move:
 		Move *move;
 		Stats stats = {0, 0, 0};
-		move = Engine_turn(board, &stats, Board_turn(board), MAX_PLY_DEPTH, verbosity);
+		Variation pv;
+		move = Engine_turn(board, &stats, Board_turn(board), MAX_PLY_DEPTH, verbosity, &pv);
 		// Show the move, save it, execute it.
 		print_move(board, move);
+		print_line(board, &pv);
 		save_move(board, move);
 		UndoableMove *um = Board_do_move(board, move);
 		// Usually we'd do this after a move, but capturing a piece in the first move
@@ -411,8 +503,10 @@ void restart_game() {
 		// If the AI was white, it gets to start right away
 		Move *move;
 		Stats stats = {0, 0, 0};
-		move = Engine_turn(board, &stats, Board_turn(board), MAX_PLY_DEPTH, verbosity);
+		Variation pv;
+		move = Engine_turn(board, &stats, Board_turn(board), MAX_PLY_DEPTH, verbosity, &pv);
 		print_move(board, move);
+		print_line(board, &pv);
 		save_move(board, move);
 		UndoableMove *um = Board_do_move(board, move);
 		Undo_destroy(um);
@@ -439,8 +533,10 @@ void swap_sides() {
 	}
 	Move *move;
 	Stats stats = {0, 0, 0};
-	move = Engine_turn(board, &stats, Board_turn(board), MAX_PLY_DEPTH, verbosity);
+	Variation pv;
+	move = Engine_turn(board, &stats, Board_turn(board), MAX_PLY_DEPTH, verbosity, &pv);
 	print_move(board, move);
+	print_line(board, &pv);
 	save_move(board, move);
 	UndoableMove *um = Board_do_move(board, move);
 	Board_add_capture(board, um);
@@ -487,7 +583,7 @@ int evaluate(int verbosity) {
 	if (verbosity != 0) {
 		printf("Evaluating %d half-moves deep", OPENING_BOOK_MAX_PLY_DEPTH);
 	}
-	Move *move = Engine_turn(board, &stats, Board_turn(board), OPENING_BOOK_MAX_PLY_DEPTH, verbosity);
+	Move *move = Engine_turn(board, &stats, Board_turn(board), OPENING_BOOK_MAX_PLY_DEPTH, verbosity, NULL);
 	int value = move->fitness;
 	printf(" %d\n",value);
 	Move_destroy(move);
@@ -495,6 +591,34 @@ int evaluate(int verbosity) {
 	return value;
 }
 
+void analyze(int lines) {
+	if (!has_game(false)) {
+		exit(1);
+	}
+	Board *board = Board_read(DEFAULT_FILE);
+	Stats stats = {0, 0, 0};
+	// One search finds the exact evaluation of all the best moves
+	Engine_set_multi_pv(lines);
+	Move *move = Engine_turn(board, &stats, Board_turn(board), MAX_PLY_DEPTH, verbosity, NULL);
+	Engine_set_multi_pv(1);
+	if (move == NULL) {
+		printf("No available moves.\n");
+		Board_destroy(board);
+		return;
+	}
+	Variation *variations = malloc(lines * sizeof(Variation));
+	int total = Engine_variations(variations, lines);
+	int i;
+	for (i = 0; i < total; i++) {
+		char *str = AN_format_line(board, variations[i].moves, variations[i].length);
+		printf("%8d  %s\n", variations[i].fitness, str);
+		free(str);
+	}
+	free(variations);
+	Move_destroy(move);
+	Board_destroy(board);
+}
+
 char * print_move(Board *board, Move *move) {
 	char *str;
 	if (algebraic) {
@@ -506,6 +630,15 @@ char * print_move(Board *board, Move *move) {
 	return str;
 }
 
+void print_line(Board *board, Variation *pv) {
+	if (verbosity == 0 || pv->length == 0) {
+		return;
+	}
+	char *str = AN_format_line(board, pv->moves, pv->length);
+	printf("Expected line: %s\n", str);
+	free(str);
+}
+
 Move * parse_move(char *str, Board *board) {
 	if (algebraic) {
 		return AN_parse(str, board);
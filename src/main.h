@@ -1,4 +1,5 @@
 #include "engine/datatypes.h"
+#include "engine/engine.h"
 
 /**
  * main.h / main.c
@@ -19,6 +20,17 @@ void version();
  * Shows usage instructions.
  */
 void usage();
+/**
+ * Returns the highest thread count the -t option accepts: the number of
+ * processor cores online, or DEFAULT_THREADS if that is higher.
+ */
+int max_threads();
+/**
+ * Applies an engine option that comes with a value, e.g. '-t 2'.
+ * Returns the number of arguments it takes, or 0 if `option` is not
+ * an engine option. Exits if the value is missing or invalid.
+ */
+int parse_engine_option(char *option, char *value);
 /**
  * Checks if there's an ongoing game present.
  */
@@ -57,10 +69,20 @@ void show_board(int simple);
  * (depending on who's turn it is).
  */
 int evaluate(int verbosity);
+/**
+ * Prints the given number of best moves for the current board,
+ * with their evaluation and the line expected to follow.
+ */
+void analyze(int lines);
 /**
  * Prints the given move and also returns the output.
  */
 char * print_move(Board *board, Move *move);
+/**
+ * Prints the line of moves the engine expects after its move, in
+ * algebraic notation, unless the output is silenced (verbosity 0).
+ */
+void print_line(Board *board, Variation *pv);
 /**
  * Parses a move from a string (shorthand notation)
  * and returns the Move (or NULL if no valid move).
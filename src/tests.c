@@ -1,13 +1,24 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "tests.h"
 #include "debug.h"
+#include "engine/algebraicnotation.h"
+#include "engine/common.h"
 #include "engine/datatypes.h"
+#include "engine/engine.h"
 #include "engine/board.h"
 #include "engine/files.h"
+#include "engine/fitness.h"
+#include "engine/heuristics.h"
+#include "engine/picker.h"
 #include "engine/piece.h"
 #include "engine/move.h"
+#include "engine/transposition.h"
+#include "engine/validator.h"
+#include "engine/zobrist.h"
 
 int test_serializer(char *filename) {
 	int i;
@@ -38,7 +49,7 @@ int test_engine() {
 	int player = WHITE;
 	Move *move;
 	for (i = 0; i < 6; i++) {
-		move = Engine_turn(b, &stats, player, 3, true);
+		move = Engine_turn(b, &stats, player, 3, true, NULL);
 		Board_do_move(b, move);
 		player = -player;
 	}
@@ -47,6 +58,374 @@ int test_engine() {
 	return true;
 }
 
+int test_time_limit() {
+	int modes[] = {PARALLEL_ROOT_SPLIT, PARALLEL_LAZY_SMP, PARALLEL_YBWC};
+	Board *b = Board_read("./testgames/kiwipete");
+	int ok = true;
+	int m;
+	Engine_set_time_limit(0.01, 0.05);
+	// The threads must all notice the deadline, in each parallel mode
+	for (m = 0; m < 3 && ok; m++) {
+		Stats stats = {0, 0, 0};
+		struct timespec start, stop;
+		Engine_set_threads(DEFAULT_THREADS, modes[m]);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		Move *move = Engine_turn(b, &stats, Board_turn(b), MAX_PLY_DEPTH, 0, NULL);
+		clock_gettime(CLOCK_MONOTONIC, &stop);
+		double duration = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+		// The first iteration is never aborted, the rest should stop in time
+		ok = move != NULL && v_is_valid_move(b, move) && duration < 1.0;
+		printf("Test time limit: %s (%.2f seconds in parallel mode %d)\n", ok ? "ok" : "fail", duration, modes[m]);
+		Move_destroy(move);
+	}
+	Engine_set_threads(DEFAULT_THREADS, PARALLEL_ROOT_SPLIT);
+	Engine_set_time_limit(SOFT_TIME_LIMIT, HARD_TIME_LIMIT);
+	Board_destroy(b);
+	return ok;
+}
+
+int test_threads() {
+	int modes[] = {PARALLEL_ROOT_SPLIT, PARALLEL_LAZY_SMP, PARALLEL_YBWC};
+	int ok = true;
+	int i, m;
+	// Time limits would make the depth differ between runs
+	Engine_set_time_limit(0, 0);
+	// The evaluation of a single thread, to compare to
+	Board *kiwipete = Board_read("./testgames/kiwipete");
+	Stats stats = {0, 0, 0};
+	Engine_set_threads(1, PARALLEL_ROOT_SPLIT);
+	Transposition_clear();
+	Move *move = Engine_turn(kiwipete, &stats, WHITE, MAX_PLY_DEPTH - 1, 0, NULL);
+	int fitness = move->fitness;
+	Move_destroy(move);
+	Board *backrank = Board_read("./testgames/backrank");
+	for (m = 0; m < 3 && ok; m++) {
+		Engine_set_threads(DEFAULT_THREADS, modes[m]);
+		// Results of all threads end up in the right place,
+		// e.g. the one mate among many moves
+		for (i = 0; i < 4 && ok; i++) {
+			stats = (Stats) {0, 0, 0};
+			Transposition_clear();
+			move = Engine_turn(backrank, &stats, WHITE, MAX_PLY_DEPTH, 0, NULL);
+			ok = move != NULL && move->gives_check_mate && move->fitness == MAX_FITNESS
+				&& move->xx == FILE_A && move->yy == RANK_8
+				&& stats.moves_count > 0;
+			Move_destroy(move);
+		}
+		// A full search gives the same evaluation as a single thread
+		for (i = 0; i < 2 && ok; i++) {
+			stats = (Stats) {0, 0, 0};
+			Transposition_clear();
+			move = Engine_turn(kiwipete, &stats, WHITE, MAX_PLY_DEPTH - 1, 0, NULL);
+			ok = move->fitness == fitness && v_is_valid_move(kiwipete, move) && stats.moves_count > 0;
+			Move_destroy(move);
+		}
+		if (!ok) {
+			printf("Test threads: fail in parallel mode %d\n", modes[m]);
+		}
+	}
+	// A single thread doesn't split, also with the pool of an earlier search
+	if (ok) {
+		Engine_set_threads(1, PARALLEL_YBWC);
+		stats = (Stats) {0, 0, 0};
+		Transposition_clear();
+		move = Engine_turn(kiwipete, &stats, WHITE, MAX_PLY_DEPTH - 1, 0, NULL);
+		ok = move->fitness == fitness && v_is_valid_move(kiwipete, move);
+		Move_destroy(move);
+	}
+	Board_destroy(backrank);
+	Board_destroy(kiwipete);
+	Engine_set_threads(DEFAULT_THREADS, PARALLEL_ROOT_SPLIT);
+	Engine_set_time_limit(SOFT_TIME_LIMIT, HARD_TIME_LIMIT);
+	printf("Test threads: %s\n", ok ? "ok" : "fail");
+	return ok;
+}
+
+int test_variation() {
+	int modes[] = {PARALLEL_ROOT_SPLIT, PARALLEL_YBWC};
+	int ok = true;
+	int m, i, j;
+	Engine_set_time_limit(0, 0);
+	Board *b = Board_read("./testgames/kiwipete");
+	for (m = 0; m < 2 && ok; m++) {
+		Engine_set_threads(m == 0 ? 1 : DEFAULT_THREADS, modes[m]);
+		Stats stats = {0, 0, 0};
+		Transposition_clear();
+		Variation pv;
+		Move *move = Engine_turn(b, &stats, WHITE, MAX_PLY_DEPTH - 1, 0, &pv);
+		// The line starts with the move that was returned, and has the same value
+		uint32_t first = MOVE_CODE(SQUARE(move->x, move->y), SQUARE(move->xx, move->yy), move->promotion);
+		ok = pv.length >= min(2, MAX_PLY_DEPTH - 1) && pv.length <= MAX_VARIATION_LENGTH
+			&& MOVE_ID(pv.moves[0]) == MOVE_ID(first)
+			&& pv.fitness == move->fitness;
+		// Each move can be played after the ones before it
+		UndoableMove undo[MAX_VARIATION_LENGTH];
+		for (i = 0; i < pv.length && ok; i++) {
+			MoveList moves;
+			v_get_moves(&moves, b, Board_turn(b));
+			for (j = 0; j < moves.count && moves.moves[j] != pv.moves[i]; j++);
+			ok = (j < moves.count);
+			Move next;
+			Move_decode(pv.moves[i], &next);
+			Board_make_move(b, &next, &undo[i]);
+		}
+		for (i--; i >= 0; i--) {
+			Board_undo_move(b, &undo[i]);
+		}
+		if (ok) {
+			char *line = AN_format_line(b, pv.moves, pv.length);
+			char *str = AN_format(b, move, true, true);
+			ok = strncmp(line, str, strlen(str)) == 0;
+			free(str);
+			free(line);
+		}
+		Move_destroy(move);
+		if (!ok) {
+			printf("Test variation: fail in parallel mode %d\n", modes[m]);
+		}
+	}
+	Board_destroy(b);
+	Engine_set_threads(DEFAULT_THREADS, PARALLEL_ROOT_SPLIT);
+	Engine_set_time_limit(SOFT_TIME_LIMIT, HARD_TIME_LIMIT);
+	printf("Test variation: %s\n", ok ? "ok" : "fail");
+	return ok;
+}
+
+int test_multi_pv() {
+	int ok = true;
+	int t, i, j;
+	Engine_set_time_limit(0, 0);
+	Board *b = Board_read("./testgames/kiwipete");
+	for (t = 0; t < 2 && ok; t++) {
+		Engine_set_threads(t == 0 ? 1 : DEFAULT_THREADS, PARALLEL_ROOT_SPLIT);
+		Engine_set_multi_pv(3);
+		Stats stats = {0, 0, 0};
+		Transposition_clear();
+		Move *move = Engine_turn(b, &stats, WHITE, MAX_PLY_DEPTH - 1, 0, NULL);
+		Variation lines[4];
+		int count = Engine_variations(lines, 4);
+		Engine_set_multi_pv(1);
+		// Three different moves, the best first, which is the move returned
+		ok = count == 3 && lines[0].fitness == move->fitness;
+		for (i = 1; i < count && ok; i++) {
+			ok = lines[i].fitness <= lines[i - 1].fitness;
+			for (j = 0; j < i; j++) {
+				ok = ok && MOVE_ID(lines[i].moves[0]) != MOVE_ID(lines[j].moves[0]);
+			}
+		}
+		Move_destroy(move);
+		// The evaluations are exact: the same as that of a
+		// search of the position after the move
+		for (i = 0; i < count && ok; i++) {
+			Move first;
+			Move_decode(lines[i].moves[0], &first);
+			UndoableMove undo;
+			Board_make_move(b, &first, &undo);
+			stats = (Stats) {0, 0, 0};
+			Transposition_clear();
+			move = Engine_turn(b, &stats, BLACK, MAX_PLY_DEPTH - 2, 0, NULL);
+			ok = move != NULL && move->fitness == lines[i].fitness;
+			Move_destroy(move);
+			Board_undo_move(b, &undo);
+		}
+		if (!ok) {
+			printf("Test multi-PV: fail with %d threads\n", t == 0 ? 1 : DEFAULT_THREADS);
+		}
+	}
+	Board_destroy(b);
+	Engine_set_threads(DEFAULT_THREADS, PARALLEL_ROOT_SPLIT);
+	Engine_set_time_limit(SOFT_TIME_LIMIT, HARD_TIME_LIMIT);
+	printf("Test multi-PV: %s\n", ok ? "ok" : "fail");
+	return ok;
+}
+
+/**
+ * Returns true if every move of `all` for which `pick` is true is in
+ * `part`, and `part` has no other moves.
+ */
+static bool same_moves(Board *b, MoveList *all, MoveList *part, bool (*pick)(Board *b, uint32_t code)) {
+	int found = 0;
+	int i, j;
+	for (i = 0; i < all->count; i++) {
+		if (pick(b, all->moves[i])) {
+			for (j = 0; j < part->count && part->moves[j] != all->moves[i]; j++);
+			if (j == part->count) {
+				return false;
+			}
+			found++;
+		}
+	}
+	return found == part->count;
+}
+
+static bool is_capture(Board *b, uint32_t code) {
+	int from = MOVE_FROM(code);
+	int to = MOVE_TO(code);
+	bool pawn = Board_is_type(b, SQUARE_X(from), SQUARE_Y(from), PAWN);
+	return (b->occupancy & (1ULL << to)) || MOVE_PROMOTION(code)
+		|| (pawn && SQUARE_X(from) != SQUARE_X(to));
+}
+
+static bool is_quiet(Board *b, uint32_t code) {
+	return !is_capture(b, code);
+}
+
+static bool is_any(Board *b, uint32_t code) {
+	(void) b;
+	(void) code;
+	return true;
+}
+
+static bool generators_tree(Board *b, int depth) {
+	int color = Board_turn(b);
+	MoveList moves, part;
+	int count = v_get_moves(&moves, b, color);
+	v_get_captures(&part, b, color);
+	bool ok = same_moves(b, &moves, &part, is_capture);
+	v_get_quiets(&part, b, color);
+	ok = ok && same_moves(b, &moves, &part, is_quiet);
+	if (v_king_at_check(b, color)) {
+		v_get_evasions(&part, b, color);
+		ok = ok && same_moves(b, &moves, &part, is_any);
+	}
+	int i;
+	for (i = 0; i < count && depth > 1 && ok; i++) {
+		Move move;
+		Move_decode(moves.moves[i], &move);
+		UndoableMove undo;
+		Board_make_move(b, &move, &undo);
+		ok = generators_tree(b, depth - 1);
+		Board_undo_move(b, &undo);
+	}
+	return ok;
+}
+
+int test_generators() {
+	Board *b = Board_read("./testgames/kiwipete");
+	int ok = generators_tree(b, 3);
+	Board_destroy(b);
+	printf("Test move generators: %s\n", ok ? "ok" : "fail");
+	return ok;
+}
+
+static bool picker_tree(Board *b, int depth) {
+	int color = Board_turn(b);
+	MoveList moves, picked;
+	int count = v_get_moves(&moves, b, color);
+	// Some move as the hash move, others as killers and countermove, one
+	// of them the hash move again. Every other node gets a killer from
+	// somewhere else, which isn't valid here.
+	static Heuristics heuristics;
+	Heuristics_clear(&heuristics);
+	uint32_t hash_move = count > 0 ? moves.moves[count / 2] : 0;
+	uint32_t previous = MOVE_CODE(SQUARE(FILE_E, RANK_2), SQUARE(FILE_E, RANK_4), 0);
+	heuristics.played[0] = previous;
+	if (count > 0) {
+		heuristics.killers[1][0] = MOVE_ID(moves.moves[count / 3]);
+		heuristics.killers[1][1] = MOVE_ID(moves.moves[count - 1]);
+		heuristics.countermoves[COLOR_INDEX(color)][MOVE_FROM(previous)][MOVE_TO(previous)] = MOVE_ID(hash_move);
+		heuristics.history[COLOR_INDEX(color)][MOVE_FROM(moves.moves[0])][MOVE_TO(moves.moves[0])] = 100;
+	}
+	if (depth % 2 == 0) {
+		heuristics.killers[1][0] = MOVE_CODE(SQUARE(FILE_A, RANK_1), SQUARE(FILE_H, RANK_8), 0);
+	}
+	MovePicker picker;
+	Picker_init(&picker, b, color, v_king_at_check(b, color), hash_move, &heuristics, 1);
+	picked.count = 0;
+	Picker_remaining(&picker, &picked);
+	bool ok = picked.count == count && same_moves(b, &moves, &picked, is_any)
+		&& (count == 0 || picked.moves[0] == hash_move);
+	int i;
+	for (i = 0; i < count && depth > 1 && ok; i++) {
+		Move move;
+		Move_decode(moves.moves[i], &move);
+		UndoableMove undo;
+		Board_make_move(b, &move, &undo);
+		ok = picker_tree(b, depth - 1);
+		Board_undo_move(b, &undo);
+	}
+	return ok;
+}
+
+int test_picker() {
+	Board *b = Board_read("./testgames/kiwipete");
+	int ok = picker_tree(b, 3);
+	Board_destroy(b);
+	printf("Test move picker: %s\n", ok ? "ok" : "fail");
+	return ok;
+}
+
+int test_heuristics() {
+	static Heuristics heuristics;
+	Heuristics_clear(&heuristics);
+	Board *b = Board_read("./testgames/kiwipete");
+	uint32_t previous = MOVE_CODE(SQUARE(FILE_B, RANK_4), SQUARE(FILE_B, RANK_3), 0);
+	uint32_t quiet = MOVE_CODE(SQUARE(FILE_A, RANK_2), SQUARE(FILE_A, RANK_3), 0);
+	uint32_t other = MOVE_CODE(SQUARE(FILE_G, RANK_2), SQUARE(FILE_G, RANK_3), 0);
+	uint32_t capture = MOVE_CODE(SQUARE(FILE_E, RANK_2), SQUARE(FILE_A, RANK_6), 0);
+	heuristics.played[0] = previous;
+	Heuristics_produced_cutoff(&heuristics, b, WHITE, 1, 4, quiet);
+	Heuristics_produced_cutoff(&heuristics, b, WHITE, 1, 2, other);
+	Heuristics_produced_cutoff(&heuristics, b, WHITE, 1, 2, capture);
+	// Two killers, the newest first, and no captures
+	int ok = heuristics.killers[1][0] == MOVE_ID(other)
+		&& heuristics.killers[1][1] == MOVE_ID(quiet)
+		&& Heuristics_countermove(&heuristics, WHITE, 1) == MOVE_ID(other)
+		&& Heuristics_countermove(&heuristics, BLACK, 1) == 0;
+	// Deeper cut-offs count more
+	int score = Heuristics_history(&heuristics, WHITE, quiet);
+	ok = ok && score > Heuristics_history(&heuristics, WHITE, other)
+		&& Heuristics_history(&heuristics, WHITE, capture) == 0
+		&& Heuristics_history(&heuristics, BLACK, quiet) == 0;
+	// Scores never go past the maximum
+	int i;
+	for (i = 0; i < 1000; i++) {
+		Heuristics_produced_cutoff(&heuristics, b, WHITE, 1, 100, quiet);
+	}
+	score = Heuristics_history(&heuristics, WHITE, quiet);
+	ok = ok && score > HISTORY_MAX / 2 && score <= HISTORY_MAX;
+	Heuristics_age(&heuristics);
+	ok = ok && Heuristics_history(&heuristics, WHITE, quiet) == score / 2
+		&& heuristics.killers[1][0] == 0;
+	Board_destroy(b);
+	printf("Test heuristics: %s\n", ok ? "ok" : "fail");
+	return ok;
+}
+
+int test_see() {
+	int ok = true;
+	Board *b = Board_read("./testgames/kiwipete");
+	// Undefended bishop
+	ok = ok && Fitness_see(b, MOVE_CODE(SQUARE(FILE_E, RANK_2), SQUARE(FILE_A, RANK_6), 0)) == 330;
+	// Pawn for pawn
+	ok = ok && Fitness_see(b, MOVE_CODE(SQUARE(FILE_D, RANK_5), SQUARE(FILE_E, RANK_6), 0)) == 0;
+	// Knight for pawn
+	ok = ok && Fitness_see(b, MOVE_CODE(SQUARE(FILE_E, RANK_5), SQUARE(FILE_G, RANK_6), 0)) == -230;
+	// Queen for knight
+	ok = ok && Fitness_see(b, MOVE_CODE(SQUARE(FILE_F, RANK_3), SQUARE(FILE_F, RANK_6), 0)) == -650;
+	Board_destroy(b);
+	// Queens behind a rook and a bishop join the exchange on e5
+	b = Board_read("./testgames/exchange");
+	ok = ok && Fitness_see(b, MOVE_CODE(SQUARE(FILE_D, RANK_3), SQUARE(FILE_E, RANK_5), 0)) == -230;
+	ok = ok && Fitness_see(b, MOVE_CODE(SQUARE(FILE_E, RANK_2), SQUARE(FILE_E, RANK_5), 0)) == -420;
+	Board_destroy(b);
+	printf("Test static exchange evaluation: %s\n", ok ? "ok" : "fail");
+	return ok;
+}
+
+int test_quiescence() {
+	// Even at depth 1, the queen shouldn't take the pawn that is defended
+	Board *b = Board_read("./testgames/defended");
+	Stats stats = {0, 0, 0};
+	Transposition_clear();
+	Move *move = Engine_turn(b, &stats, WHITE, 1, 0, NULL);
+	int ok = move != NULL && !(move->xx == FILE_D && move->yy == RANK_5);
+	Move_destroy(move);
+	Board_destroy(b);
+	printf("Test quiescence: %s\n", ok ? "ok" : "fail");
+	return ok;
+}
+
 void test_check(int player) {
 	Board *b = debug_generate_random();
 	printf("White at check at fields:\n");
@@ -69,7 +448,7 @@ int test_validator() {
 			Board_remove_piece(b,i,j);
 		}
 	}
-	Board_set(b, FILE_A, RANK_1, Piece_create(KING, WHITE));
+	Board_set(b, FILE_A, RANK_1, Piece_get(KING, WHITE));
 
 	int vm_count[] = {
 		3 + 1, // PAWN
@@ -83,7 +462,7 @@ int test_validator() {
 		int count;
 		Move *head = Move_alloc();
 		// Put a single piece back at the center
-		Board_set(b, FILE_E, RANK_4, Piece_create(i, WHITE));
+		Board_set(b, FILE_E, RANK_4, Piece_get(i, WHITE));
 		// Get all valid moves:
 		count = v_get_all_valid_moves_for_color(&head, b, WHITE);
 		Move_destroy(head);
@@ -102,6 +481,147 @@ int test_validator() {
 }
 
 
+/**
+ * Counts the leaf nodes of the move tree up to the given depth.
+ */
+static long perft(Board *b, int depth) {
+	MoveList moves;
+	int count = v_get_moves(&moves, b, Board_turn(b));
+	if (depth == 1) {
+		return count;
+	}
+	long total = 0;
+	int i;
+	for (i = 0; i < count; i++) {
+		Move move;
+		Move_decode(moves.moves[i], &move);
+		UndoableMove undo;
+		Board_make_move(b, &move, &undo);
+		total += perft(b, depth - 1);
+		Board_undo_move(b, &undo);
+	}
+	return total;
+}
+
+int test_perft() {
+	// "Kiwipete", a position full of pins, checks, castling and en passant.
+	// The well known counts assume under-promotion to rook and bishop,
+	// which this engine doesn't generate, but there are no promotions
+	// in the first three plies.
+	long expected[] = {48, 2039, 97862};
+	int ok = true;
+	Board *b = Board_read("./testgames/kiwipete");
+	int depth;
+	for (depth = 1; depth <= 3; depth++) {
+		long count = perft(b, depth);
+		if (count != expected[depth - 1]) {
+			printf("Test perft: fail! Depth %d should have %ld moves but has %ld.\n", depth, expected[depth - 1], count);
+			ok = false;
+			break;
+		}
+	}
+	Board_destroy(b);
+	if (ok) {
+		printf("Test perft: ok\n");
+	}
+	return ok;
+}
+
+/**
+ * Checks the incremental hash and material balance against fresh
+ * ones for every move and its undo, up to the given depth.
+ */
+static bool hash_tree(Board *b, int depth) {
+	MoveList moves;
+	int count = v_get_moves(&moves, b, Board_turn(b));
+	uint64_t hash = b->hash;
+	int material = b->material;
+	int i;
+	for (i = 0; i < count; i++) {
+		Move move;
+		Move_decode(moves.moves[i], &move);
+		UndoableMove undo;
+		Board_make_move(b, &move, &undo);
+		bool ok = b->hash == Zobrist_hash(b)
+			&& b->material == Fitness_material(b)
+			&& (depth == 1 || hash_tree(b, depth - 1));
+		Board_undo_move(b, &undo);
+		if (!ok || b->hash != hash || b->material != material) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int test_zobrist() {
+	Board *b = Board_read("./testgames/kiwipete");
+	int ok = hash_tree(b, 2);
+	Board_destroy(b);
+
+	// The same position reached in a different order has the same hash,
+	// 1. Nf3 Nf6 2. Nc3 vs. 1. Nc3 Nf6 2. Nf3
+	Move *m[3];
+	m[0] = Move_create(WHITE, FILE_G, RANK_1, FILE_F, RANK_3, 0);
+	m[1] = Move_create(BLACK, FILE_G, RANK_8, FILE_F, RANK_6, 0);
+	m[2] = Move_create(WHITE, FILE_B, RANK_1, FILE_C, RANK_3, 0);
+	Board *left = Board_create();
+	Board *right = Board_create();
+	UndoableMove undo;
+	Board_make_move(left, m[0], &undo);
+	Board_make_move(left, m[1], &undo);
+	Board_make_move(left, m[2], &undo);
+	Board_make_move(right, m[2], &undo);
+	Board_make_move(right, m[1], &undo);
+	Board_make_move(right, m[0], &undo);
+	ok = ok && left->hash == right->hash;
+
+	// A null move only passes the turn, and undoing it restores the hash
+	Move *push = Move_create(BLACK, FILE_E, RANK_7, FILE_E, RANK_5, 0);
+	Board_make_move(left, push, &undo);
+	uint64_t hash = left->hash;
+	UndoableMove null;
+	Board_make_null_move(left, &null);
+	ok = ok && Board_turn(left) == BLACK && left->hash != hash && left->hash == Zobrist_hash(left);
+	Board_undo_null_move(left, &null);
+	ok = ok && Board_turn(left) == WHITE && left->hash == hash;
+	printf("Test zobrist: %s\n", ok ? "ok" : "fail");
+	int i;
+	for (i = 0; i < 3; i++) {
+		Move_destroy(m[i]);
+	}
+	Move_destroy(push);
+	Board_destroy(left);
+	Board_destroy(right);
+	return ok;
+}
+
+int test_transposition() {
+	Board *b = Board_create();
+	uint64_t hash = b->hash;
+	uint32_t move = MOVE_CODE(SQUARE(FILE_E, RANK_2), SQUARE(FILE_E, RANK_4), 0) | MOVE_GIVES_CHECK;
+	Transposition t;
+	Transposition_clear();
+	int ok = !Transposition_probe(hash, &t);
+	// Negative scores and flags must survive packing
+	Transposition_store(hash, -1234, 3, BOUND_UPPER, move);
+	ok = ok && Transposition_probe(hash, &t)
+		&& t.score == -1234 && t.depth == 3 && t.bound == BOUND_UPPER && t.move == MOVE_ID(move);
+	// A shallower bound doesn't replace a deeper one from the same search
+	Transposition_store(hash, 50, 1, BOUND_LOWER, 0);
+	ok = ok && Transposition_probe(hash, &t) && t.score == -1234 && t.depth == 3;
+	// But it does once it's from an earlier search
+	Transposition_new_search();
+	Transposition_store(hash, 50, 1, BOUND_LOWER, 0);
+	ok = ok && Transposition_probe(hash, &t) && t.score == 50 && t.depth == 1;
+	// Other positions aren't found
+	ok = ok && !Transposition_probe(hash ^ 1, &t);
+	Transposition_clear();
+	Board_destroy(b);
+	printf("Test transposition table: %s\n", ok ? "ok" : "fail");
+	return ok;
+}
+
+
 int test_moves() {
 	Board *b, *backup;
 	Move *m[5];
@@ -13,6 +13,50 @@ int test_moves();
  */
 int test_validator();
 
+/**
+ * Counts all legal move sequences of a few plies deep from
+ * a tricky position, and compares them to the known numbers.
+ */
+int test_perft();
+
+/**
+ * Compares the moves of the captures, quiets and evasions
+ * generators to all valid moves, in many positions.
+ */
+int test_generators();
+
+/**
+ * Checks that the move picker hands out every valid move exactly
+ * once, with the hash move first, in many positions, with killer
+ * moves and countermoves that may or may not be valid.
+ */
+int test_picker();
+
+/**
+ * Checks the killer moves, countermoves and history scores
+ * that are remembered after a cut-off, and their aging.
+ */
+int test_heuristics();
+
+/**
+ * Checks the static exchange evaluation of a few captures,
+ * including exchanges with pieces that attack through others.
+ */
+int test_see();
+
+/**
+ * Compares the incremental hash and material balance of the board to freshly
+ * calculated ones after making and undoing moves, and checks that a transposition
+ * gives the same hash, and that a null move only changes the side to move.
+ */
+int test_zobrist();
+
+/**
+ * Stores and looks up a position in the transposition table,
+ * and checks which entries are replaced.
+ */
+int test_transposition();
+
 /**
  * Writes a random board to file and reads it, compares the result.
  */
@@ -23,6 +67,37 @@ int test_serializer(char *filename);
  */
 int test_engine();
 
+/**
+ * Gives the engine a very short time limit for a deep search, with all
+ * threads in each parallel mode, and checks that it still returns a valid
+ * move, in time.
+ */
+int test_time_limit();
+
+/**
+ * Searches with all threads, in each parallel mode, and checks
+ * that the results are not mixed up between threads.
+ */
+int test_threads();
+
+/**
+ * Checks that the principal variation starts with the move the engine
+ * returns, consists of valid moves, and can be written down in
+ * algebraic notation, also when it is put together by several threads.
+ */
+int test_variation();
+
+/**
+ * Asks the engine for the three best moves, and checks that they are
+ * ordered and that their evaluations are exact.
+ */
+int test_multi_pv();
+
+/**
+ * Checks that the quiescence search sees a piece is defended.
+ */
+int test_quiescence();
+
 /**
  * Prints the fields that give check.
  * Not really a unit test, requires manually checking the output.